@@ -0,0 +1,207 @@
+#include "harness.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Every allocation of the program is counted, so that the numbers include allocations made inside
+// the storages, the standard library and asio.
+
+namespace {
+
+std::atomic<std::size_t> allocation_count{0};
+std::atomic<std::size_t> allocation_bytes{0};
+
+void *
+counted_allocate(std::size_t n)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (auto p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+}
+
+void *
+operator new(std::size_t n)
+{
+    return counted_allocate(n);
+}
+
+void *
+operator new[](std::size_t n)
+{
+    return counted_allocate(n);
+}
+
+void
+operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace bench {
+
+allocation_stats
+allocations()
+{
+    return {allocation_count.load(std::memory_order_relaxed), allocation_bytes.load(std::memory_order_relaxed)};
+}
+
+std::vector<benchmark> &
+registry()
+{
+    static std::vector<benchmark> benchmarks;
+    return benchmarks;
+}
+
+std::string
+format_size(std::size_t n)
+{
+    if (n >= (1u << 20) && n % (1u << 20) == 0)
+        return std::to_string(n >> 20) + "MiB";
+    if (n >= 1024 && n % 1024 == 0)
+        return std::to_string(n >> 10) + "KiB";
+    return std::to_string(n) + "B";
+}
+
+}
+
+namespace {
+
+struct options
+{
+    std::vector<std::string> filters;
+    double min_time = 0.1;
+    bool list = false;
+};
+
+void
+usage(char const *program)
+{
+    std::printf(
+        "usage: %s [--min-time=SECONDS] [--list] [FILTER...]\n"
+        "  runs the benchmarks whose names contain any FILTER, or all of them\n",
+        program);
+}
+
+bool
+selected(
+    options const &opts,
+    std::string const &name)
+{
+    if (opts.filters.empty())
+        return true;
+    for (auto &f : opts.filters)
+        if (name.find(f) != std::string::npos)
+            return true;
+    return false;
+}
+
+// run the benchmark with an increasing number of iterations until one run lasts at least min_time
+void
+measure(
+    bench::benchmark const &b,
+    double min_time,
+    int name_width)
+{
+    std::size_t iterations = 1;
+    for (;;)
+    {
+        auto st = bench::state(iterations);
+        b.run(st);
+        st.stop_timing();
+        auto seconds = st.seconds();
+
+        if (seconds >= min_time || iterations >= (std::size_t(1) << 40))
+        {
+            auto ns_per_op = seconds * 1e9 / double(iterations);
+            auto mib_per_s = double(st.bytes) / seconds / double(1 << 20);
+            auto allocs_per_op = double(st.allocation_count()) / double(iterations);
+            std::printf("%-*s %12zu %14.1f %12.1f %12.3f  %s\n",
+                        name_width, b.name.c_str(), iterations, ns_per_op, mib_per_s, allocs_per_op, st.label.c_str());
+            std::fflush(stdout);
+            return;
+        }
+
+        // aim for 1.5 times the minimum time, growing by at most 100 times per step
+        auto factor = seconds > 0 ? min_time * 1.5 / seconds : 100.0;
+        if (factor > 100.0)
+            factor = 100.0;
+        if (factor < 2.0)
+            factor = 2.0;
+        iterations = std::size_t(double(iterations) * factor);
+    }
+}
+
+}
+
+int
+main(
+    int argc,
+    char **argv)
+{
+    auto opts = options();
+    for (int i = 1; i < argc; ++i)
+    {
+        auto arg = std::string(argv[i]);
+        if (arg.rfind("--min-time=", 0) == 0)
+            opts.min_time = std::atof(arg.c_str() + std::strlen("--min-time="));
+        else if (arg == "--list")
+            opts.list = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (arg.rfind("--", 0) == 0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            opts.filters.push_back(arg);
+    }
+
+    int name_width = 16;
+    for (auto &b : bench::registry())
+        if (selected(opts, b.name))
+            name_width = std::max(name_width, int(b.name.size()));
+
+    if (!opts.list)
+        std::printf("%-*s %12s %14s %12s %12s\n",
+                    name_width, "benchmark", "iterations", "ns/op", "MiB/s", "allocs/op");
+
+    for (auto &b : bench::registry())
+    {
+        if (!selected(opts, b.name))
+            continue;
+        if (opts.list)
+            std::printf("%s\n", b.name.c_str());
+        else
+            measure(b, opts.min_time, name_width);
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/// Counts of the calls to the global operator new made by the program so far
+struct allocation_stats
+{
+    std::size_t count;
+    std::size_t bytes;
+};
+
+allocation_stats
+allocations();
+
+/// The measurement of one run of a benchmark
+class state
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit
+    state(std::size_t iterations)
+        : iterations_(iterations)
+    {
+        start_timing();
+    }
+
+    /// The number of times to perform the operation
+    std::size_t
+    iterations() const
+    {
+        return iterations_;
+    }
+
+    /// Restart the measurement, excluding any setup done so far
+    void
+    start_timing()
+    {
+        allocations_at_start_ = allocations();
+        start_ = clock::now();
+    }
+
+    /// End the measurement, excluding any teardown which follows
+    void
+    stop_timing()
+    {
+        if (stopped_)
+            return;
+        stop_ = clock::now();
+        allocations_at_stop_ = allocations();
+        stopped_ = true;
+    }
+
+    double
+    seconds() const
+    {
+        return std::chrono::duration<double>(stop_ - start_).count();
+    }
+
+    /// The number of allocations made during the measurement
+    std::size_t
+    allocation_count() const
+    {
+        return allocations_at_stop_.count - allocations_at_start_.count;
+    }
+
+    /// The number of payload bytes processed, for the throughput
+    std::size_t bytes = 0;
+
+    /// Further results, printed after the standard columns
+    std::string label;
+
+private:
+    std::size_t iterations_;
+    bool stopped_ = false;
+    allocation_stats allocations_at_start_;
+    allocation_stats allocations_at_stop_;
+    clock::time_point start_;
+    clock::time_point stop_;
+};
+
+using benchmark_function = std::function<void(state &)>;
+
+struct benchmark
+{
+    std::string name;
+    benchmark_function run;
+};
+
+std::vector<benchmark> &
+registry();
+
+inline void
+add(
+    std::string name,
+    benchmark_function run)
+{
+    registry().push_back({std::move(name), std::move(run)});
+}
+
+/// Register benchmarks from a translation unit: `static bench::registrar r([]{ bench::add(...); });`
+struct registrar
+{
+    template<class F>
+    explicit
+    registrar(F f)
+    {
+        f();
+    }
+};
+
+/// Prevent the optimiser from discarding a computed value
+template<class T>
+inline void
+do_not_optimize(T const &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile T sink;
+    sink = value;
+#endif
+}
+
+/// A payload size in human readable form, e.g. 16B, 4KiB, 64MiB
+std::string
+format_size(std::size_t n);
+
+}
@@ -0,0 +1,295 @@
+#include "harness.hpp"
+#include "storage_kinds.hpp"
+
+#include <boost/beast/read_until.hpp>
+#include <boost/beast/_experimental/test/stream.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A reader takes CRLF terminated lines from a stream while a writer on the same io_context sends them.
+//
+// The writer sends `depth` lines at a time, in writes of up to `chunk` bytes, and sends the next batch
+// once the reader has taken every line of the previous one. With depth 1 each line is a round trip;
+// larger depths model pipelined requests. Over test::stream the reader also reads at most `chunk` bytes
+// at a time. One op is one line. The latency of a line runs from the start of its batch's first write
+// to the completion of the read which returns it.
+
+namespace {
+
+using namespace bench::storage_kinds;
+
+using clock_type = std::chrono::steady_clock;
+
+struct parameters
+{
+    std::size_t line;
+    std::size_t chunk;
+    std::size_t depth;
+};
+
+struct beast_read_until_crlf
+{
+    static constexpr char const *name = "async_read_until_crlf";
+
+    template<class Stream, class DynamicBuffer, class Handler>
+    void
+    operator()(Stream &stream, DynamicBuffer dyn_buf, Handler &&handler) const
+    {
+        beast::async_read_until_crlf(stream, dyn_buf, std::forward<Handler>(handler));
+    }
+};
+
+struct net_read_until
+{
+    static constexpr char const *name = "net::async_read_until";
+
+    template<class Stream, class DynamicBuffer, class Handler>
+    void
+    operator()(Stream &stream, DynamicBuffer dyn_buf, Handler &&handler) const
+    {
+        net::async_read_until(stream, dyn_buf, "\r\n", std::forward<Handler>(handler));
+    }
+};
+
+struct test_stream_transport
+{
+    static constexpr char const *name = "test_stream";
+
+    using stream_type = beast::test::stream;
+
+    static std::pair<stream_type, stream_type>
+    open(net::io_context &ioc, parameters const &p)
+    {
+        auto reader = stream_type(ioc);
+        auto writer = beast::test::connect(reader);
+        reader.read_size(p.chunk);
+        return {std::move(reader), std::move(writer)};
+    }
+};
+
+struct unix_transport
+{
+    static constexpr char const *name = "unix";
+
+    using stream_type = net::local::stream_protocol::socket;
+
+    static std::pair<stream_type, stream_type>
+    open(net::io_context &ioc, parameters const &)
+    {
+        auto reader = stream_type(ioc);
+        auto writer = stream_type(ioc);
+        net::local::connect_pair(reader, writer);
+        return {std::move(reader), std::move(writer)};
+    }
+};
+
+struct tcp_transport
+{
+    static constexpr char const *name = "tcp";
+
+    using stream_type = net::ip::tcp::socket;
+
+    static std::pair<stream_type, stream_type>
+    open(net::io_context &ioc, parameters const &)
+    {
+        auto acceptor = net::ip::tcp::acceptor(ioc, {net::ip::address_v4::loopback(), 0});
+        auto writer = stream_type(ioc);
+        writer.connect(acceptor.local_endpoint());
+        auto reader = acceptor.accept();
+        reader.set_option(net::ip::tcp::no_delay(true));
+        writer.set_option(net::ip::tcp::no_delay(true));
+        return {std::move(reader), std::move(writer)};
+    }
+};
+
+template<class Stream, class Reader, class DynamicBuffer>
+class read_loop
+{
+public:
+
+    read_loop(
+        Stream &reader,
+        Stream &writer,
+        DynamicBuffer dyn_buf,
+        parameters const &p,
+        std::size_t lines,
+        std::vector<double> &latencies)
+        : reader_(reader)
+        , writer_(writer)
+        , dyn_buf_(dyn_buf)
+        , chunk_(p.chunk)
+        , depth_(p.depth)
+        , lines_(lines)
+        , latencies_(latencies)
+    {
+        for (std::size_t i = 0; i < p.depth; ++i)
+            batch_ += std::string(p.line - 2, 'x') + "\r\n";
+    }
+
+    void
+    start()
+    {
+        write_batch();
+        read_line();
+    }
+
+    std::size_t
+    bytes() const
+    {
+        return bytes_;
+    }
+
+private:
+
+    void
+    write_batch()
+    {
+        batch_start_ = clock_type::now();
+        write_from(0);
+    }
+
+    void
+    write_from(std::size_t offset)
+    {
+        auto n = std::min(chunk_, batch_.size() - offset);
+        net::async_write(writer_, net::buffer(batch_.data() + offset, n),
+                         [this, offset](beast::error_code ec, std::size_t n)
+                         {
+                             if (ec)
+                                 throw beast::system_error(ec);
+                             if (offset + n < batch_.size())
+                                 write_from(offset + n);
+                         });
+    }
+
+    void
+    read_line()
+    {
+        Reader()(reader_, dyn_buf_, [this](beast::error_code ec, std::size_t n)
+        {
+            if (ec)
+                throw beast::system_error(ec);
+            latencies_.push_back(std::chrono::duration<double>(clock_type::now() - batch_start_).count());
+            bytes_ += n;
+            dyn_buf_.consume(n);
+            if (++done_ == lines_)
+                return;
+            if (done_ % depth_ == 0)
+                write_batch();
+            read_line();
+        });
+    }
+
+    Stream &reader_;
+    Stream &writer_;
+    DynamicBuffer dyn_buf_;
+    std::size_t chunk_;
+    std::size_t depth_;
+    std::size_t lines_;
+    std::vector<double> &latencies_;
+    std::string batch_;
+    clock_type::time_point batch_start_;
+    std::size_t done_ = 0;
+    std::size_t bytes_ = 0;
+};
+
+double
+percentile(
+    std::vector<double> &values,
+    double fraction)
+{
+    auto nth = values.begin() + std::ptrdiff_t(double(values.size() - 1) * fraction);
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+template<class Transport, class Reader, class Kind>
+void
+run_read_loop(
+    bench::state &st,
+    parameters const &p)
+{
+    auto lines = (st.iterations() + p.depth - 1) / p.depth * p.depth;
+
+    net::io_context ioc(1);
+    auto streams = Transport::open(ioc, p);
+    auto storage = Kind::make(64 * 1024);
+    auto dyn_buf = beast::dynamic_buffer(*storage);
+    auto latencies = std::vector<double>();
+    latencies.reserve(lines);
+    auto loop = read_loop<typename Transport::stream_type, Reader, decltype(dyn_buf)>(
+        streams.first, streams.second, dyn_buf, p, lines, latencies);
+
+    st.start_timing();
+    loop.start();
+    ioc.run();
+    st.stop_timing();
+
+    st.bytes = loop.bytes();
+    char label[128];
+    std::snprintf(label, sizeof(label), "lines/s=%.0f p50=%.2fus p99=%.2fus",
+                  double(lines) / st.seconds(),
+                  percentile(latencies, 0.5) * 1e6,
+                  percentile(latencies, 0.99) * 1e6);
+    st.label = label;
+}
+
+constexpr std::size_t line_sizes[] = {32, 512};
+constexpr std::size_t chunk_sizes[] = {256, 16 * 1024};
+constexpr std::size_t depths[] = {1, 64};
+
+template<class Transport, class Reader, class Kind>
+void
+register_combination()
+{
+    for (auto line : line_sizes)
+        for (auto chunk : chunk_sizes)
+            for (auto depth : depths)
+            {
+                auto p = parameters{line, chunk, depth};
+                auto name = std::string("read_loop/") + Transport::name + "/" + Reader::name + "/" + Kind::name
+                    + "/line=" + std::to_string(line)
+                    + "/chunk=" + std::to_string(chunk)
+                    + "/depth=" + std::to_string(depth);
+                bench::add(name, [p](bench::state &st)
+                {
+                    run_read_loop<Transport, Reader, Kind>(st, p);
+                });
+            }
+}
+
+template<class Transport, class Reader>
+void
+register_storages()
+{
+    register_combination<Transport, Reader, static_kind>();
+    register_combination<Transport, Reader, flat_kind>();
+    register_combination<Transport, Reader, circular_kind>();
+    register_combination<Transport, Reader, multi_kind>();
+    register_combination<Transport, Reader, multi_buffer_kind>();
+}
+
+template<class Transport>
+void
+register_readers()
+{
+    register_storages<Transport, beast_read_until_crlf>();
+    register_storages<Transport, net_read_until>();
+}
+
+bench::registrar read_loop_benchmarks([]
+{
+    register_readers<test_stream_transport>();
+    register_readers<unix_transport>();
+    register_readers<tcp_transport>();
+});
+
+}
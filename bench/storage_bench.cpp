@@ -0,0 +1,170 @@
+#include "harness.hpp"
+#include "storage_kinds.hpp"
+
+#include <random>
+#include <string>
+
+// Grow, shrink, consume and data patterns run against each storage through its v2 dynamic buffer.
+//
+//  append        write the payload in reads of up to 4 KiB, then consume it all. One op is one payload.
+//  line_consume  write the payload in reads of up to 4 KiB, consuming 64 byte lines as they complete,
+//                inspecting each line first. One op is one payload.
+//  random_window with the payload resident, visit every buffer of data(pos, n) for a random window of
+//                up to 4 KiB. One op is one window.
+
+namespace {
+
+using namespace bench::storage_kinds;
+
+constexpr std::size_t line_size = 64;
+
+constexpr std::size_t payload_sizes[] = {
+    16, 256, 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024};
+
+std::string const &
+source()
+{
+    static auto const s = []
+    {
+        auto s = std::string(read_size, ' ');
+        for (std::size_t i = 0; i < s.size(); ++i)
+            s[i] = char('a' + i % 26);
+        return s;
+    }();
+    return s;
+}
+
+template<class DynamicBuffer>
+void
+append(
+    DynamicBuffer &dyn_buf,
+    std::size_t n)
+{
+    auto pos = dyn_buf.size();
+    dyn_buf.grow(n);
+    net::buffer_copy(dyn_buf.data(pos, n), net::buffer(source().data(), n));
+}
+
+// touch every buffer of a window, as a parser would
+template<class BufferSequence>
+std::size_t
+visit(BufferSequence const &buffers)
+{
+    std::size_t sum = 0;
+    for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it)
+    {
+        auto buf = net::const_buffer(*it);
+        sum += buf.size() + std::size_t(static_cast<unsigned char const *>(buf.data())[0]);
+    }
+    return sum;
+}
+
+template<class Kind>
+void
+run_append(
+    bench::state &st,
+    std::size_t payload)
+{
+    auto storage = Kind::make(payload);
+    auto dyn_buf = beast::dynamic_buffer(*storage);
+    st.start_timing();
+    for (std::size_t i = 0; i < st.iterations(); ++i)
+    {
+        for (std::size_t done = 0; done < payload; done += read_size)
+            append(dyn_buf, std::min(read_size, payload - done));
+        bench::do_not_optimize(dyn_buf.size());
+        dyn_buf.consume(dyn_buf.size());
+    }
+    st.stop_timing();
+    st.bytes = payload * st.iterations();
+}
+
+template<class Kind>
+void
+run_line_consume(
+    bench::state &st,
+    std::size_t payload)
+{
+    auto storage = Kind::make(payload);
+    auto dyn_buf = beast::dynamic_buffer(*storage);
+    auto const line = std::min(line_size, payload);
+    st.start_timing();
+    for (std::size_t i = 0; i < st.iterations(); ++i)
+    {
+        for (std::size_t done = 0; done < payload; done += read_size)
+        {
+            append(dyn_buf, std::min(read_size, payload - done));
+            while (dyn_buf.size() >= line)
+            {
+                bench::do_not_optimize(visit(dyn_buf.data(0, line)));
+                dyn_buf.consume(line);
+            }
+        }
+        dyn_buf.consume(dyn_buf.size());
+    }
+    st.stop_timing();
+    st.bytes = payload * st.iterations();
+}
+
+template<class Kind>
+void
+run_random_window(
+    bench::state &st,
+    std::size_t payload)
+{
+    auto storage = Kind::make(payload);
+    auto dyn_buf = beast::dynamic_buffer(*storage);
+    for (std::size_t done = 0; done < payload; done += read_size)
+        append(dyn_buf, std::min(read_size, payload - done));
+
+    auto rng = std::minstd_rand(42);
+    st.start_timing();
+    for (std::size_t i = 0; i < st.iterations(); ++i)
+    {
+        auto pos = rng() % payload;
+        auto n = std::min<std::size_t>(rng() % read_size + 1, payload - pos);
+        bench::do_not_optimize(visit(dyn_buf.data(pos, n)));
+        st.bytes += n;
+    }
+    st.stop_timing();
+}
+
+template<class Kind>
+void
+register_kind()
+{
+    for (auto payload : payload_sizes)
+    {
+        if (payload > Kind::max_payload)
+            continue;
+        auto suffix = std::string("/") + Kind::name + "/" + bench::format_size(payload);
+        bench::add("append" + suffix, [payload](bench::state &st)
+        {
+            run_append<Kind>(st, payload);
+        });
+        bench::add("line_consume" + suffix, [payload](bench::state &st)
+        {
+            run_line_consume<Kind>(st, payload);
+        });
+        bench::add("random_window" + suffix, [payload](bench::state &st)
+        {
+            run_random_window<Kind>(st, payload);
+        });
+    }
+}
+
+bench::registrar storage_benchmarks([]
+{
+    register_kind<static_kind>();
+    register_kind<flat_kind>();
+    register_kind<small_flat_kind>();
+    register_kind<circular_kind>();
+    register_kind<multi_kind>();
+    register_kind<multi_buffer_kind>();
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    register_kind<mapped_file_kind>();
+    register_kind<spill_kind>();
+#endif
+});
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/static_storage.hpp>
+#include <boost/beast/flat_storage.hpp>
+#include <boost/beast/circular_storage.hpp>
+#include <boost/beast/multi_storage.hpp>
+#include <boost/beast/multi_buffer_dynamic_proxy.hpp>
+#include <boost/beast/mapped_file_storage.hpp>
+#include <boost/beast/spill_storage.hpp>
+#include <memory>
+
+// The storages under test. Each kind names a storage type and makes one able to hold a payload of the
+// given size plus one read of read_size bytes.
+
+namespace bench {
+namespace storage_kinds {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+constexpr std::size_t read_size = 4096;
+
+// static_storage consume() moves the remaining bytes, so it is only run with payloads it is meant for
+struct static_kind
+{
+    using storage_type = beast::static_storage<1024 * 1024 + read_size>;
+
+    static constexpr char const *name = "static_storage";
+    static constexpr std::size_t max_payload = 64 * 1024;
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>();
+    }
+};
+
+struct flat_kind
+{
+    using storage_type = beast::flat_storage;
+
+    static constexpr char const *name = "flat_storage";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>();
+    }
+};
+
+struct small_flat_kind
+{
+    using storage_type = beast::small_flat_storage<256>;
+
+    static constexpr char const *name = "small_flat_storage<256>";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>();
+    }
+};
+
+struct circular_kind
+{
+    using storage_type = beast::circular_storage;
+
+    static constexpr char const *name = "circular_storage";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t payload)
+    {
+        return std::make_unique<storage_type>(payload + read_size);
+    }
+};
+
+struct multi_kind
+{
+    using storage_type = beast::multi_storage;
+
+    static constexpr char const *name = "multi_storage";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>();
+    }
+};
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+// in an unlinked file under /var/tmp, so the numbers depend on what /var/tmp is
+struct mapped_file_kind
+{
+    using storage_type = beast::mapped_file_storage;
+
+    static constexpr char const *name = "mapped_file_storage";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>(storage_type::temporary());
+    }
+};
+
+// in memory up to 1 MiB, so the larger payloads spill to a file under /var/tmp
+struct spill_kind
+{
+    using storage_type = beast::spill_storage;
+
+    static constexpr char const *name = "spill_storage";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>(1024 * 1024);
+    }
+};
+#endif
+
+struct multi_buffer_kind
+{
+    using storage_type = beast::multi_buffer;
+
+    static constexpr char const *name = "multi_buffer_dynamic_proxy";
+    static constexpr std::size_t max_payload = std::size_t(-1);
+
+    static std::unique_ptr<storage_type>
+    make(std::size_t)
+    {
+        return std::make_unique<storage_type>();
+    }
+};
+
+}
+}
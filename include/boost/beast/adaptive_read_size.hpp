@@ -0,0 +1,86 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <algorithm>
+#include <cstddef>
+
+namespace boost {
+namespace beast {
+
+/// Chooses how many bytes a composed read operation should ask for in each read_some.
+///
+/// The read size doubles, up to the upper bound, each time a read fills the whole region offered,
+/// and halves, down to the lower bound, each time a read returns less than half of it. A fast stream
+/// thus settles on large reads while a trickle of small messages does not keep large regions grown.
+///
+/// A composed operation calls next() with the space left in its buffer, reads into that many bytes and
+/// then reports the outcome with update(). Keep an instance across operations on the same stream to
+/// carry what was learned from one operation into the next.
+class adaptive_read_size
+{
+public:
+
+    static constexpr std::size_t default_initial = 4096;
+    static constexpr std::size_t default_lower = 512;
+    static constexpr std::size_t default_upper = 64 * 1024;
+
+    /// Start at `initial` bytes, adapting between `lower` and `upper`
+    explicit
+    adaptive_read_size(
+        std::size_t initial = default_initial,
+        std::size_t lower = default_lower,
+        std::size_t upper = default_upper)
+        : current_(std::min(std::max(initial, lower), upper))
+        , lower_(lower)
+        , upper_(upper)
+    {
+        BOOST_ASSERT(lower > 0 && lower <= upper);
+    }
+
+    /// A fixed read size, which update() does not change
+    static
+    adaptive_read_size
+    fixed(std::size_t n)
+    {
+        return adaptive_read_size(n, n, n);
+    }
+
+    /// The current read size
+    std::size_t
+    current() const
+    {
+        return current_;
+    }
+
+    /// The number of bytes to read next, given the space available in the buffer
+    std::size_t
+    next(std::size_t available) const
+    {
+        return std::min(current_, available);
+    }
+
+    /// Adapt to a read of `transferred` bytes into a region of `requested` bytes
+    void
+    update(
+        std::size_t requested,
+        std::size_t transferred)
+    {
+        if (transferred == requested)
+        {
+            // a region clamped by the buffer's limit says nothing about the stream
+            if (requested == current_)
+                current_ = std::min(current_ * 2, upper_);
+        }
+        else if (transferred < requested / 2)
+            current_ = std::max(current_ / 2, lower_);
+    }
+
+private:
+
+    std::size_t current_;
+    std::size_t lower_;
+    std::size_t upper_;
+};
+
+}
+}
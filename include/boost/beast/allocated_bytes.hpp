@@ -0,0 +1,157 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/core/empty_value.hpp>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && __cplusplus >= 201703L
+#include <memory_resource>
+#define BOOST_BEAST_HAS_STD_PMR 1
+#endif
+#endif
+
+namespace boost {
+namespace beast {
+
+/// An owned array of bytes obtained from an allocator, which is stored without overhead when empty
+template<class Allocator>
+class allocated_bytes
+    : private boost::empty_value<typename std::allocator_traits<Allocator>::template rebind_alloc<char>>
+{
+    using base_alloc_type = typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+    using alloc_traits = std::allocator_traits<base_alloc_type>;
+    using base_type = boost::empty_value<base_alloc_type>;
+
+public:
+
+    using allocator_type = Allocator;
+
+    explicit
+    allocated_bytes(Allocator const &alloc = Allocator())
+        : base_type(boost::empty_init_t(), alloc)
+        , p_(nullptr)
+        , n_(0)
+    {}
+
+    allocated_bytes(
+        std::size_t n,
+        Allocator const &alloc)
+        : base_type(boost::empty_init_t(), alloc)
+        , p_(n ? alloc_traits::allocate(this->get(), n) : nullptr)
+        , n_(n)
+    {}
+
+    allocated_bytes(allocated_bytes &&other) noexcept
+        : base_type(boost::empty_init_t(), std::move(other.alloc()))
+        , p_(std::exchange(other.p_, nullptr))
+        , n_(std::exchange(other.n_, 0))
+    {}
+
+    /// Take ownership of the bytes of other, taking its allocator too if the allocator propagates on move
+    /// assignment. Otherwise, if the allocators differ, the bytes are copied into an allocation of ours
+    /// and other's are released.
+    allocated_bytes &
+    operator=(allocated_bytes &&other) noexcept(
+        alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value)
+    {
+        if (this != &other)
+            move_assign(other, typename alloc_traits::propagate_on_container_move_assignment());
+        return *this;
+    }
+
+    allocated_bytes(allocated_bytes const &) = delete;
+
+    allocated_bytes &
+    operator=(allocated_bytes const &) = delete;
+
+    ~allocated_bytes()
+    {
+        release();
+    }
+
+    char *
+    data() const
+    {
+        return p_;
+    }
+
+    std::size_t
+    size() const
+    {
+        return n_;
+    }
+
+    allocator_type
+    get_allocator() const
+    {
+        return allocator_type(alloc());
+    }
+
+    void
+    release()
+    {
+        if (p_)
+            alloc_traits::deallocate(alloc(), p_, n_);
+        p_ = nullptr;
+        n_ = 0;
+    }
+
+private:
+
+    void
+    move_assign(allocated_bytes &other, std::true_type) noexcept
+    {
+        release();
+        alloc() = std::move(other.alloc());
+        take(other);
+    }
+
+    void
+    move_assign(allocated_bytes &other, std::false_type)
+    {
+        if (alloc() == other.alloc())
+        {
+            release();
+            take(other);
+            return;
+        }
+
+        auto p = other.n_ ? alloc_traits::allocate(alloc(), other.n_) : nullptr;
+        if (other.n_)
+            std::memcpy(p, other.p_, other.n_);
+        release();
+        p_ = p;
+        n_ = other.n_;
+        other.release();
+    }
+
+    void
+    take(allocated_bytes &other) noexcept
+    {
+        p_ = std::exchange(other.p_, nullptr);
+        n_ = std::exchange(other.n_, 0);
+    }
+
+    base_alloc_type &
+    alloc()
+    {
+        return this->get();
+    }
+
+    base_alloc_type const &
+    alloc() const
+    {
+        return this->get();
+    }
+
+    char *p_;
+    std::size_t n_;
+};
+
+}
+}
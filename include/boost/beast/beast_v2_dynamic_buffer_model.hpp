@@ -3,6 +3,7 @@
 namespace boost {
 namespace beast {
 
+/// The v2 dynamic buffer interface over a storage, whose calls are reported to the storage's StatsPolicy
 template<class Storage>
 class beast_v2_dynamic_buffer_model
 {
@@ -35,12 +36,14 @@ public:
     const_buffers_type
     data(std::size_t pos, std::size_t n) const
     {
+        storage_->stats_policy().on_data();
         return static_cast<storage_type const*>(storage_)->data(pos, n);
     }
 
     mutable_buffers_type
     data(std::size_t pos, std::size_t n)
     {
+        storage_->stats_policy().on_data();
         return storage_->data(pos, n);
     }
 
@@ -50,18 +53,21 @@ public:
         if (size() + n > max_size())
             throw std::length_error("grow");
 
+        storage_->stats_policy().on_grow(n);
         return storage_->grow(n);
     }
 
     void
     shrink(std::size_t n)
     {
+        storage_->stats_policy().on_shrink(n);
         return storage_->shrink(n);
     }
 
     void
     consume(std::size_t n)
     {
+        storage_->stats_policy().on_consume(n);
         return storage_->consume(n);
     }
 
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace boost {
+namespace beast {
+namespace detail {
+
+/// Blocks are sized in powers of two from min_size to max_size. Larger requests bypass the recycler.
+struct chunk_size_classes
+{
+    static constexpr std::size_t min_size = 256;
+    static constexpr std::size_t max_size = 1024 * 1024;
+    static constexpr std::size_t count = 13;
+
+    static_assert(min_size << (count - 1) == max_size, "");
+
+    // the class of a block of n bytes, or count if n is too large
+    static
+    std::size_t
+    index(std::size_t n)
+    {
+        std::size_t i = 0;
+        auto size = min_size;
+        while (size < n && i < count)
+        {
+            size *= 2;
+            ++i;
+        }
+        return i;
+    }
+
+    static
+    std::size_t
+    size(std::size_t index)
+    {
+        return min_size << index;
+    }
+
+    // the number of free blocks of a class a thread may hold, about 256 KiB but at least 4
+    static
+    std::size_t
+    thread_limit(std::size_t index)
+    {
+        auto const blocks = (256 * 1024) >> (index + 8);
+        return blocks < 4 ? 4 : blocks;
+    }
+
+    static
+    std::size_t
+    global_limit(std::size_t index)
+    {
+        return 64 * thread_limit(index);
+    }
+};
+
+// a free block, linked through its first bytes
+struct free_block
+{
+    free_block *next;
+};
+
+struct free_list
+{
+    free_block *head = nullptr;
+    std::size_t length = 0;
+
+    void
+    push(free_block *b)
+    {
+        b->next = head;
+        head = b;
+        ++length;
+    }
+
+    free_block *
+    pop()
+    {
+        auto b = head;
+        head = b->next;
+        --length;
+        return b;
+    }
+
+    void
+    release()
+    {
+        while (head)
+            ::operator delete(pop());
+    }
+};
+
+/// Free blocks returned by threads whose own caches overflowed or which exited
+class global_chunk_pool
+{
+public:
+
+    static
+    global_chunk_pool &
+    instance()
+    {
+        static global_chunk_pool pool;
+        return pool;
+    }
+
+    // move up to max blocks of class index into list
+    void
+    take(std::size_t index, free_list &list, std::size_t max)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &from = lists_[index];
+        while (from.head && max--)
+            list.push(from.pop());
+    }
+
+    // accept blocks of class index from list, freeing those beyond the global limit
+    void
+    give(std::size_t index, free_list &list, std::size_t n)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto &to = lists_[index];
+            while (list.head && n && to.length < chunk_size_classes::global_limit(index))
+            {
+                to.push(list.pop());
+                --n;
+            }
+        }
+        while (list.head && n--)
+            ::operator delete(list.pop());
+    }
+
+    std::size_t
+    cached_blocks(std::size_t index)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lists_[index].length;
+    }
+
+    ~global_chunk_pool()
+    {
+        for (auto &list : lists_)
+            list.release();
+    }
+
+private:
+
+    global_chunk_pool() = default;
+
+    std::mutex mutex_;
+    std::array<free_list, chunk_size_classes::count> lists_;
+};
+
+/// The free blocks cached by one thread, handed to the global pool when the thread exits
+class thread_chunk_cache
+{
+public:
+
+    static
+    thread_chunk_cache &
+    instance()
+    {
+        static thread_local thread_chunk_cache cache(global_chunk_pool::instance());
+        return cache;
+    }
+
+    void *
+    allocate(std::size_t index)
+    {
+        auto &list = lists_[index];
+        if (!list.head)
+            global_.take(index, list, chunk_size_classes::thread_limit(index) / 2 + 1);
+        if (list.head)
+            return list.pop();
+        return ::operator new(chunk_size_classes::size(index));
+    }
+
+    void
+    deallocate(void *p, std::size_t index)
+    {
+        auto &list = lists_[index];
+        list.push(static_cast<free_block *>(p));
+        if (list.length > chunk_size_classes::thread_limit(index))
+            global_.give(index, list, list.length / 2);
+    }
+
+    std::size_t
+    cached_blocks(std::size_t index) const
+    {
+        return lists_[index].length;
+    }
+
+    ~thread_chunk_cache()
+    {
+        for (std::size_t i = 0; i < lists_.size(); ++i)
+            global_.give(i, lists_[i], lists_[i].length);
+    }
+
+private:
+
+    explicit
+    thread_chunk_cache(global_chunk_pool &global)
+        : global_(global)
+    {}
+
+    // the global pool is constructed first, so it outlives the caches of all threads
+    global_chunk_pool &global_;
+    std::array<free_list, chunk_size_classes::count> lists_;
+};
+
+}
+
+/// Size-classed recycler of memory blocks.
+///
+/// Freed blocks are kept on a free list of the calling thread, without locking. When a thread's list
+/// for a size class exceeds its bound, half of it is handed to a global pool, from which threads
+/// whose lists are empty refill. Blocks are aligned for any type with fundamental alignment.
+struct chunk_recycler
+{
+    /// The size of the block which allocate(n) returns
+    static
+    std::size_t
+    block_size(std::size_t n)
+    {
+        auto index = detail::chunk_size_classes::index(n);
+        return index < detail::chunk_size_classes::count ? detail::chunk_size_classes::size(index) : n;
+    }
+
+    static
+    void *
+    allocate(std::size_t n)
+    {
+        auto index = detail::chunk_size_classes::index(n);
+        if (index == detail::chunk_size_classes::count)
+            return ::operator new(n);
+        return detail::thread_chunk_cache::instance().allocate(index);
+    }
+
+    /// Recycle a block obtained from allocate(n)
+    static
+    void
+    deallocate(void *p, std::size_t n)
+    {
+        auto index = detail::chunk_size_classes::index(n);
+        if (index == detail::chunk_size_classes::count)
+            ::operator delete(p);
+        else
+            detail::thread_chunk_cache::instance().deallocate(p, index);
+    }
+
+    /// The number of free blocks of size block_size(n) held by the calling thread
+    static
+    std::size_t
+    thread_cached_blocks(std::size_t n)
+    {
+        return detail::thread_chunk_cache::instance().cached_blocks(detail::chunk_size_classes::index(n));
+    }
+
+    /// The number of free blocks of size block_size(n) held by the global pool
+    static
+    std::size_t
+    global_cached_blocks(std::size_t n)
+    {
+        return detail::global_chunk_pool::instance().cached_blocks(detail::chunk_size_classes::index(n));
+    }
+};
+
+/// An allocator drawing from the chunk_recycler. All instances are interchangeable.
+///
+/// Use it as the Allocator of basic_flat_storage, basic_circular_storage, basic_multi_storage or
+/// basic_multi_buffer to share recycled blocks between all of them.
+template<class T>
+class recycling_allocator
+{
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+
+    recycling_allocator() = default;
+
+    template<class U>
+    recycling_allocator(recycling_allocator<U> const &) noexcept
+    {}
+
+    T *
+    allocate(std::size_t n)
+    {
+        if (n > std::size_t(-1) / sizeof(T))
+            throw std::bad_array_new_length();
+        return static_cast<T *>(chunk_recycler::allocate(n * sizeof(T)));
+    }
+
+    void
+    deallocate(T *p, std::size_t n)
+    {
+        chunk_recycler::deallocate(p, n * sizeof(T));
+    }
+
+    template<class U>
+    bool
+    operator==(recycling_allocator<U> const &) const noexcept
+    {
+        return true;
+    }
+
+    template<class U>
+    bool
+    operator!=(recycling_allocator<U> const &) const noexcept
+    {
+        return false;
+    }
+};
+
+}
+}
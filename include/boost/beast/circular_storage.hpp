@@ -1,263 +1,180 @@
 #pragma once
 
 #include <boost/beast/core/detail/config.hpp>
-#include <boost/beast/is_beast_v2_dynamic_buffer.hpp>
-#include <array>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/upto2_buffers.hpp>
+#include <boost/beast/allocated_bytes.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <memory>
 
 namespace boost {
 namespace beast {
 
-template<class BufferType>
-struct basic_upto2_buffers
-    {
-    using storage_type = std::array<BufferType, 2>;
-    using iterator = typename storage_type::iterator;
-    using const_iterator = typename storage_type::const_iterator;
-
-    const_iterator
-    begin() const
-    { return store_.data(); }
+/// Opaque storage type for resizable buffer storage in circular layout
+///
+/// The fixed capacity is obtained from the Allocator on construction.
+template<
+    class Allocator = std::allocator<char>,
+    class StatsPolicy = no_storage_stats>
+class basic_circular_storage
+    : public detail::with_storage_stats<StatsPolicy>
+{
+    using this_class = basic_circular_storage<Allocator, StatsPolicy>;
 
-    iterator
-    begin()
-    { return store_.data(); }
+public:
+    using allocator_type = Allocator;
 
-    const_iterator
-    end() const
-    { return begin() + size_; }
+    /// grow() never moves the readable bytes
+    static constexpr bool stable_growth = true;
 
-    iterator
-    end()
-    { return begin() + size_; }
+private:
+    // internal dynamic buffer interface
+    using mutable_buffers_type = mutable_upto2_buffers;
+    using const_buffers_type = const_upto2_buffers;
 
-public:
-    explicit basic_upto2_buffers(
-        BufferType b1 = {},
-        BufferType b2 = {})
-        : store_()
-        , size_(0)
+    std::size_t
+    size() const
     {
-        maybe_append(b1);
-        maybe_append(b2);
+        return size_;
     }
 
-private:
-
-    void
-    maybe_append(BufferType b)
+    std::size_t
+    max_size() const
     {
-        if (b.size() == 0)
-            return;
-
-        store_[size_++] = b;
+        return capacity_;
     }
 
-private:
-    storage_type store_;
-    std::size_t size_;
-};
-
-using mutable_upto2_buffers = basic_upto2_buffers<net::mutable_buffer>;
-using const_upto2_buffers = basic_upto2_buffers<net::const_buffer>;
-
+    std::size_t
+    capacity() const
+    {
+        return capacity_;
+    }
 
-/// Opaque storage type for resizable buffer storage in circular layout
-struct circular_storage
-{
-// interface
-    using mutable_buffers_type = mutable_upto2_buffers;
-    using const_buffers_type = const_upto2_buffers;
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        auto first = index(pos);
+        auto to_end = capacity_ - first;
+        if (n <= to_end)
+            return const_buffers_type(net::const_buffer(begin_store() + first, n));
+        return const_buffers_type(net::const_buffer(begin_store() + first, to_end),
+                                  net::const_buffer(begin_store(), n - to_end));
+    }
 
     mutable_buffers_type
-    prepare(std::size_t n)
+    data(std::size_t pos, std::size_t n)
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        auto first = index(pos);
+        auto to_end = capacity_ - first;
+        if (n <= to_end)
+            return mutable_buffers_type(net::mutable_buffer(begin_store() + first, n));
+        return mutable_buffers_type(net::mutable_buffer(begin_store() + first, to_end),
+                                    net::mutable_buffer(begin_store(), n - to_end));
+    }
+
+    void
+    grow(std::size_t n)
     {
         if (n > (capacity_ - size_))
-        {
             boost::throw_exception(std::length_error("out of space"));
-        }
 
-        auto here = input_end_;
-        input_end_ = advance_ptr(input_end_, n);
         size_ += n;
-
-        return region(here, input_end_);
+        this->stats_policy().on_resize(size_, capacity_);
     }
 
     void
-    consume(std::size_t n)
+    shrink(std::size_t n)
     {
-        n = std::min(size_, n);
-        output_start_ = advance_ptr(output_start_, n);
-        size_ -= n;
+        size_ -= std::min(n, size_);
     }
 
     void
-    dispose_input(std::size_t n)
+    consume(std::size_t n)
     {
-        n = std::min(n, size_);
+        n = std::min(size_, n);
         size_ -= n;
-        input_end_ = retreat_ptr(input_end_, n);
-    }
-
-    const_buffers_type
-    data() const
-    {
-        auto result = size_
-                      ? region(output_start_, input_end_)
-                      : const_buffers_type();
-        return result;
+        // when empty, restart at the front so that the next data is contiguous
+        start_ = size_ ? index(n) : 0;
     }
 
-    mutable_buffers_type
-    data()
-    {
-        auto result = size_
-                      ? region(output_start_, input_end_)
-                      : mutable_buffers_type();
-        return result;
-    }
+    friend beast_v2_dynamic_buffer_model<this_class>;
 
-    std::size_t
-    max_size() const
+public:
+    allocator_type
+    get_allocator() const
     {
-        return capacity_;
+        return store_.get_allocator();
     }
 
 // constructors
 public:
-    circular_storage(std::size_t limit)
+    basic_circular_storage(
+        std::size_t limit,
+        Allocator const &alloc = Allocator())
         : capacity_(limit)
         , size_(0)
-        , store_(allocate(limit))
-        , output_start_(store_.get())
-        , input_end_(store_.get())
-    {}
-
-private:
-
-    using pointer = char *;
-
-    mutable_buffers_type
-    region(
-        pointer from,
-        pointer to)
+        , start_(0)
+        , store_(limit, alloc)
     {
-        if (to <= from)
-        {
-            return mutable_buffers_type(
-                asio::mutable_buffer(from, std::distance(from, end_store())),
-                asio::mutable_buffer(begin_store(), std::distance(begin_store(), to))
-            );
-        }
-        else
-        {
-            return mutable_buffers_type(
-                asio::mutable_buffer(from, std::distance(from, to))
-            );
-        }
+        if (limit)
+            this->stats_policy().on_allocate(limit);
     }
 
-    const_buffers_type
-    region(
-        pointer from,
-        pointer to) const
-    {
-        if (to <= from)
-        {
-            return const_buffers_type(
-                asio::const_buffer(from, std::distance(from, end_store())),
-                asio::const_buffer(begin_store(), std::distance(begin_store(), to))
-            );
-        }
-        else
-        {
-            return const_buffers_type(
-                asio::const_buffer(from, std::distance(from, to))
-            );
-        }
-    }
-
-    // pre: there must be sufficient unused space
-    pointer
-    advance_ptr(
-        pointer p,
-        std::size_t n)
-    {
-        auto dist_to_end = std::size_t(std::distance(p, end_store()));
-        if (dist_to_end <= n)
-        {
-            p = begin_store();
-            n -= dist_to_end;
-        }
-        p += n;
-        return p;
-    }
+private:
 
-    pointer
-    retreat_ptr(
-        pointer p,
-        std::size_t n)
-    {
-        auto dist_from_start = std::size_t(std::distance(begin_store(), p));
-        if (dist_from_start < n)
-        {
-            p = end_store();
-            n -= dist_from_start;
-        }
-        p -= n;
-        return p;
-    }
+    using pointer = char *;
 
-    static
-    pointer
-    allocate(std::size_t n)
+    // index in the store of the byte at offset pos from the first readable byte
+    std::size_t
+    index(std::size_t pos) const
     {
-        return reinterpret_cast<pointer>(std::malloc(n));
+        auto i = start_ + pos;
+        return i >= capacity_ ? i - capacity_ : i;
     }
 
     pointer
     begin_store() const
     {
-        return store_.get();
+        return store_.data();
     }
 
-    pointer
-    end_store() const
-    {
-        return begin_store() + capacity_;
-    }
+    std::size_t capacity_;
+    std::size_t size_;          // size of used space
+    std::size_t start_;         // index of the first readable byte
+    allocated_bytes<Allocator> store_;
+};
 
+using circular_storage = basic_circular_storage<>;
 
-    struct deleter
-    {
-        void
-        operator()(pointer p) const
-        {
-            std::free(p);
-        }
-    };
+#if BOOST_BEAST_HAS_STD_PMR
+namespace pmr {
+using circular_storage = basic_circular_storage<std::pmr::polymorphic_allocator<char>>;
+}
+#endif
 
-    std::size_t capacity_;
-    std::size_t size_;          // size of used space. Used to avoid complex ptr atrithmetic
-    std::unique_ptr<char, deleter> store_;
-    pointer output_start_;
-    pointer input_end_;
+template<class Allocator, class StatsPolicy = no_storage_stats>
+struct basic_circular_storage_dynamic_buffer
+    : beast_v2_dynamic_buffer_model<basic_circular_storage<Allocator, StatsPolicy>>
+{
+    using base_class = beast_v2_dynamic_buffer_model<basic_circular_storage<Allocator, StatsPolicy>>;
 
+    using base_class::base_class;
 };
 
-struct circular_storage_dynamic_buffer
-    : beast_v2_dynamic_buffer_model<circular_storage>
-{
-    using beast_v2_dynamic_buffer_model::beast_v2_dynamic_buffer_model;
-};
+using circular_storage_dynamic_buffer = basic_circular_storage_dynamic_buffer<std::allocator<char>>;
 
-inline auto
-dynamic_buffer(circular_storage &storage)
--> circular_storage_dynamic_buffer
+template<class Allocator, class StatsPolicy>
+auto
+dynamic_buffer(basic_circular_storage<Allocator, StatsPolicy> &storage)
+-> basic_circular_storage_dynamic_buffer<Allocator, StatsPolicy>
 {
     return {storage};
 }
 
 
 }
-}
\ No newline at end of file
+}
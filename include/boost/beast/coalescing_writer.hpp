@@ -0,0 +1,348 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/async_base.hpp>
+#include <boost/beast/core/buffer_traits.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/beast/core/detail/type_traits.hpp>
+#include <boost/beast/small_buffers.hpp>
+#include <boost/beast/storage_traits.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/basic_waitable_timer.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace boost {
+namespace beast {
+
+template<class AsyncWriteStream, class DynamicBuffer>
+class coalescing_writer;
+
+namespace detail {
+
+template<class AsyncWriteStream,
+    class DynamicBuffer,
+    class Handler>
+struct coalescing_flush_op
+    : boost::asio::coroutine
+      , async_base<Handler, boost::beast::executor_type<AsyncWriteStream>>
+{
+    coalescing_flush_op(
+        coalescing_writer<AsyncWriteStream, DynamicBuffer> &writer,
+        Handler handler)
+        : async_base<Handler,
+        boost::beast::executor_type<AsyncWriteStream>>(
+        std::move(handler),
+        writer.stream_.get_executor())
+        , writer_(writer)
+    {
+        ++writer_.flush_waiters_;
+        (*this)();
+    }
+
+#include <boost/asio/yield.hpp>
+
+    void
+    operator()(error_code = {})
+    {
+        reenter(this)
+        {
+            for (;;)
+            {
+                if (writer_.ec_ || writer_.idle())
+                    break;
+
+                writer_.maybe_flush();
+
+                // the idle timer never expires; the writer cancels it each time it goes idle or fails
+                yield writer_.idle_timer_.async_wait(std::move(*this));
+                is_continuation_ = true;
+            }
+
+            --writer_.flush_waiters_;
+            this->complete(is_continuation_, writer_.ec_);
+        }
+    }
+
+#include <boost/asio/unyield.hpp>
+
+private:
+    coalescing_writer<AsyncWriteStream, DynamicBuffer> &writer_;
+    bool is_continuation_ = false;
+};
+
+}
+
+/// Coalesces small messages into a dynamic buffer and writes them with gather writes.
+///
+/// write() copies a message into the buffer. Whatever has accumulated is sent with one async_write_some
+/// over data(0, size()), so while a write is in flight the messages behind it collect into the next one.
+/// With a flush delay the writer also holds messages back until flush_size bytes are queued or the delay
+/// has passed since the first of them. cork() holds everything back until uncork() or async_flush().
+///
+/// While a write is in flight, messages go into the buffer only if it has_stable_growth; otherwise, and
+/// when a fixed capacity buffer is full, they are staged and moved into it once the write completes.
+/// The buffer must support grow() without a following shrink(), which the multi_buffer proxy does not.
+///
+/// The writer starts operations of its own, so it must outlive them: close the stream, and let the
+/// io_context run until they complete, before destroying it. The first write error is kept: it is
+/// reported by error() and async_flush(), and later messages are discarded.
+template<class AsyncWriteStream, class DynamicBuffer>
+class coalescing_writer
+{
+public:
+
+    using clock_type = std::chrono::steady_clock;
+
+    static constexpr std::size_t default_flush_size = 64 * 1024;
+
+    /// A writer to `stream` through `buffer`. With the default zero flush delay, messages are written as
+    /// soon as the stream is idle and flush_size is unused.
+    explicit
+    coalescing_writer(
+        AsyncWriteStream &stream,
+        DynamicBuffer buffer,
+        std::size_t flush_size = default_flush_size,
+        clock_type::duration flush_delay = clock_type::duration::zero())
+        : stream_(stream)
+        , dyn_buf_(buffer)
+        , flush_size_(flush_size)
+        , flush_delay_(flush_delay)
+        , delay_timer_(stream.get_executor())
+        , idle_timer_(stream.get_executor(), clock_type::time_point::max())
+    {
+        static_assert(is_async_write_stream<AsyncWriteStream>::value,
+                      "AsyncWriteStream type requirements not met");
+        static_assert(
+            net::is_dynamic_buffer_v2<DynamicBuffer>::value,
+            "DynamicBuffer type requirements not met");
+    }
+
+    coalescing_writer(coalescing_writer const &) = delete;
+    coalescing_writer &operator=(coalescing_writer const &) = delete;
+
+    /// Queue the bytes of a message. Throws std::length_error if they do not fit in the buffer while
+    /// no write is in flight.
+    template<class ConstBufferSequence>
+    void
+    write(ConstBufferSequence const &message)
+    {
+        if (ec_)
+            return;
+
+        auto n = buffer_bytes(message);
+        if (n == 0)
+            return;
+
+        if (writing_ && (!staged_.empty() || !fits_in_place(n)))
+        {
+            auto pos = staged_.size();
+            staged_.resize(pos + n);
+            net::buffer_copy(net::buffer(&staged_[pos], n), message);
+            return;
+        }
+
+        auto pos = dyn_buf_.size();
+        dyn_buf_.grow(n);
+        net::buffer_copy(dyn_buf_.data(pos, n), message);
+        if (!writing_)
+            maybe_flush();
+    }
+
+    /// Hold back messages until uncork()
+    void
+    cork()
+    {
+        corked_ = true;
+        cancel_delay();
+    }
+
+    /// Resume writing, sending what accumulated while corked
+    void
+    uncork()
+    {
+        corked_ = false;
+        if (!writing_ && dyn_buf_.size())
+            start_write();
+    }
+
+    bool
+    corked() const
+    {
+        return corked_;
+    }
+
+    /// The number of bytes queued and not yet written, including any in flight
+    std::size_t
+    pending() const
+    {
+        return dyn_buf_.size() + staged_.size();
+    }
+
+    /// The first write error, if any
+    error_code
+    error() const
+    {
+        return ec_;
+    }
+
+    /// Write everything queued, even when corked, and complete once nothing is pending or a write fails.
+    /// Messages queued while it waits are written too.
+    template<class FlushHandler>
+    BOOST_BEAST_ASYNC_RESULT1(FlushHandler)
+    async_flush(FlushHandler &&handler)
+    {
+        return net::async_initiate<
+            FlushHandler,
+            void(error_code)>(
+            run_flush_op{this},
+            handler);
+    }
+
+private:
+
+    template<class, class, class>
+    friend struct detail::coalescing_flush_op;
+
+    using timer_type = net::basic_waitable_timer<
+        clock_type,
+        net::wait_traits<clock_type>,
+        boost::beast::executor_type<AsyncWriteStream>>;
+
+    struct run_flush_op
+    {
+        coalescing_writer *self;
+
+        template<class FlushHandler>
+        void
+        operator()(FlushHandler &&h)
+        {
+            static_assert(
+                detail::is_invocable<FlushHandler, void(error_code)>::value,
+                "FlushHandler type requirements not met");
+
+            detail::coalescing_flush_op<
+                AsyncWriteStream,
+                DynamicBuffer,
+                typename std::decay<FlushHandler>::type>(*self, std::forward<FlushHandler>(h));
+        }
+    };
+
+    bool
+    idle() const
+    {
+        return !writing_ && pending() == 0;
+    }
+
+    // whether n more bytes can go into the buffer without moving the bytes in flight
+    bool
+    fits_in_place(std::size_t n) const
+    {
+        return has_stable_growth<DynamicBuffer>::value && dyn_buf_.max_size() - dyn_buf_.size() >= n;
+    }
+
+    void
+    maybe_flush()
+    {
+        if (writing_ || ec_ || dyn_buf_.size() == 0)
+            return;
+
+        if (flush_waiters_ || (!corked_ && (flush_delay_ == clock_type::duration::zero()
+                                            || dyn_buf_.size() >= flush_size_)))
+            start_write();
+        else if (!corked_ && !delay_armed_)
+        {
+            delay_armed_ = true;
+            delay_timer_.expires_after(flush_delay_);
+            delay_timer_.async_wait([this](error_code ec)
+                                    {
+                                        if (ec == net::error::operation_aborted)
+                                            return;
+                                        delay_armed_ = false;
+                                        if (!writing_ && !corked_ && dyn_buf_.size())
+                                            start_write();
+                                    });
+        }
+    }
+
+    void
+    start_write()
+    {
+        cancel_delay();
+        writing_ = true;
+
+        // fixed pointers, so that the bytes in flight stay put however the buffer's sequence is computed
+        auto buffers = const_small_buffers<8>(dyn_buf_.data(0, dyn_buf_.size()));
+        stream_.async_write_some(buffers, [this](error_code ec, std::size_t n)
+        {
+            on_write(ec, n);
+        });
+    }
+
+    void
+    on_write(
+        error_code ec,
+        std::size_t bytes_transferred)
+    {
+        writing_ = false;
+        if (ec)
+        {
+            ec_ = ec;
+            idle_timer_.cancel();
+            return;
+        }
+
+        dyn_buf_.consume(bytes_transferred);
+        unstage();
+        if (dyn_buf_.size() == 0)
+            idle_timer_.cancel();
+        else
+            maybe_flush();
+    }
+
+    // move as many staged bytes into the buffer as fit
+    void
+    unstage()
+    {
+        auto n = std::min(staged_.size(), dyn_buf_.max_size() - dyn_buf_.size());
+        if (n == 0)
+            return;
+
+        auto pos = dyn_buf_.size();
+        dyn_buf_.grow(n);
+        net::buffer_copy(dyn_buf_.data(pos, n), net::buffer(staged_.data(), n));
+        staged_.erase(0, n);
+    }
+
+    void
+    cancel_delay()
+    {
+        if (delay_armed_)
+        {
+            delay_armed_ = false;
+            delay_timer_.cancel();
+        }
+    }
+
+    AsyncWriteStream &stream_;
+    DynamicBuffer dyn_buf_;
+    std::size_t flush_size_;
+    clock_type::duration flush_delay_;
+    timer_type delay_timer_;
+    timer_type idle_timer_;
+    std::string staged_;            // messages queued behind a write which could not go into the buffer
+    std::size_t flush_waiters_ = 0;
+    error_code ec_;
+    bool writing_ = false;
+    bool corked_ = false;
+    bool delay_armed_ = false;
+};
+
+}
+}
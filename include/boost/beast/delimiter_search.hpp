@@ -0,0 +1,269 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/string.hpp>
+#include <boost/asio/buffer.hpp>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define BOOST_BEAST_DELIMITER_SEARCH_SSE2 1
+#define BOOST_BEAST_DELIMITER_SEARCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace boost {
+namespace beast {
+namespace detail {
+
+/// A search kernel returns the start of the first occurrence of the k byte delimiter lying
+/// entirely within [first, last), or nullptr. k is never zero.
+using delimiter_search_kernel = char const *(*)(
+    char const *first,
+    char const *last,
+    char const *delim,
+    std::size_t k);
+
+inline char const *
+delimiter_search_scalar(
+    char const *first,
+    char const *last,
+    char const *delim,
+    std::size_t k)
+{
+    if (std::size_t(last - first) < k)
+        return nullptr;
+
+    auto const final_start = last - (k - 1);
+    for (auto p = first; p != final_start; ++p)
+    {
+        p = static_cast<char const *>(std::memchr(p, delim[0], std::size_t(final_start - p)));
+        if (!p)
+            break;
+        if (std::memcmp(p + 1, delim + 1, k - 1) == 0)
+            return p;
+    }
+    return nullptr;
+}
+
+#if BOOST_BEAST_DELIMITER_SEARCH_SSE2
+
+// Candidates are positions where both the first and the last byte of the delimiter match; they are
+// found 16 at a time and confirmed with memcmp. For a single byte delimiter the two tests coincide.
+inline char const *
+delimiter_search_sse2(
+    char const *first,
+    char const *last,
+    char const *delim,
+    std::size_t k)
+{
+    if (std::size_t(last - first) < k)
+        return nullptr;
+
+    auto const head = _mm_set1_epi8(delim[0]);
+    auto const tail = _mm_set1_epi8(delim[k - 1]);
+    auto p = first;
+    for (; std::size_t(last - p) >= k - 1 + 16; p += 16)
+    {
+        auto const block_head = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        auto const block_tail = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + k - 1));
+        auto mask = unsigned(_mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(block_head, head),
+            _mm_cmpeq_epi8(block_tail, tail))));
+        while (mask)
+        {
+            auto candidate = p + __builtin_ctz(mask);
+            if (k <= 2 || std::memcmp(candidate + 1, delim + 1, k - 2) == 0)
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return delimiter_search_scalar(p, last, delim, k);
+}
+
+#endif
+
+#if BOOST_BEAST_DELIMITER_SEARCH_AVX2
+
+__attribute__((target("avx2")))
+inline char const *
+delimiter_search_avx2(
+    char const *first,
+    char const *last,
+    char const *delim,
+    std::size_t k)
+{
+    if (std::size_t(last - first) < k)
+        return nullptr;
+
+    auto const head = _mm256_set1_epi8(delim[0]);
+    auto const tail = _mm256_set1_epi8(delim[k - 1]);
+    auto p = first;
+    for (; std::size_t(last - p) >= k - 1 + 32; p += 32)
+    {
+        auto const block_head = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+        auto const block_tail = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + k - 1));
+        auto mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(block_head, head),
+            _mm256_cmpeq_epi8(block_tail, tail))));
+        while (mask)
+        {
+            auto candidate = p + __builtin_ctz(mask);
+            if (k <= 2 || std::memcmp(candidate + 1, delim + 1, k - 2) == 0)
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return delimiter_search_sse2(p, last, delim, k);
+}
+
+#endif
+
+/// The fastest kernel supported by the running processor, chosen once
+inline delimiter_search_kernel
+select_delimiter_search_kernel()
+{
+    static delimiter_search_kernel const kernel = []
+    {
+#if BOOST_BEAST_DELIMITER_SEARCH_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return delimiter_search_kernel(&delimiter_search_avx2);
+#endif
+#if BOOST_BEAST_DELIMITER_SEARCH_SSE2
+        return delimiter_search_kernel(&delimiter_search_sse2);
+#else
+        return delimiter_search_kernel(&delimiter_search_scalar);
+#endif
+    }();
+    return kernel;
+}
+
+}
+
+/// Incremental search for a delimiter over the segments of a buffer sequence.
+///
+/// Each call to search() is given the bytes following those already searched, typically
+/// `data(searched(), size() - searched())` of a v2 dynamic buffer. Segments are searched in place by
+/// the selected kernel. Only the last `delimiter.size() - 1` bytes seen are retained, so that matches
+/// straddling segment boundaries, or successive calls, are found without linearising the data.
+class delimiter_search
+{
+public:
+
+    explicit
+    delimiter_search(
+        string_view delimiter,
+        detail::delimiter_search_kernel kernel = detail::select_delimiter_search_kernel())
+        : delim_(delimiter.data(), delimiter.size())
+        , kernel_(kernel)
+    {
+        BOOST_ASSERT(!delim_.empty());
+    }
+
+    /// The number of bytes searched so far without finding the delimiter
+    std::size_t
+    searched() const
+    {
+        return searched_;
+    }
+
+    /// Start a new search, forgetting the bytes searched so far
+    void
+    reset()
+    {
+        carry_.clear();
+        searched_ = 0;
+    }
+
+    /// Continue the search over the buffer sequence.
+    ///
+    /// @return the offset, counted from the first byte ever searched, one past the end of the first
+    /// occurrence of the delimiter; or 0 if there is none yet.
+    template<class ConstBufferSequence>
+    std::size_t
+    search(ConstBufferSequence const &buffers)
+    {
+        auto const k = delim_.size();
+        for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it)
+        {
+            auto buf = net::const_buffer(*it);
+            if (buf.size() == 0)
+                continue;
+
+            auto first = static_cast<char const *>(buf.data());
+            auto last = first + buf.size();
+
+            // a match starting in the retained bytes ends within the first k - 1 bytes of this segment.
+            // Matches all have length k, so the earliest to start is also the earliest to end.
+            for (std::size_t j = 0; j < carry_.size(); ++j)
+            {
+                auto in_carry = carry_.size() - j;
+                auto rest = k - in_carry;
+                if (rest <= buf.size()
+                    && std::memcmp(carry_.data() + j, delim_.data(), in_carry) == 0
+                    && std::memcmp(first, delim_.data() + in_carry, rest) == 0)
+                    return searched_ + rest;
+            }
+
+            auto match = kernel_(first, last, delim_.data(), k);
+            if (match)
+                return searched_ + std::size_t(match - first) + k;
+
+            if (k > 1)
+            {
+                auto keep = std::min(buf.size(), k - 1);
+                carry_.append(last - keep, keep);
+                if (carry_.size() > k - 1)
+                    carry_.erase(0, carry_.size() - (k - 1));
+            }
+            searched_ += buf.size();
+        }
+        return 0;
+    }
+
+    /// Continue the search over contiguous bytes, the first searched() of which were searched before.
+    ///
+    /// As the bytes already searched are still present, matches straddling them and the new bytes are
+    /// found by searching again from k - 1 bytes before the new ones, and nothing is retained. A search
+    /// must use either this or search(), not both.
+    ///
+    /// @return the offset one past the end of the first occurrence of the delimiter, or 0 if there is
+    /// none yet.
+    std::size_t
+    search_contiguous(
+        char const *data,
+        std::size_t size)
+    {
+        BOOST_ASSERT(size >= searched_ && carry_.empty());
+        auto const k = delim_.size();
+        auto const from = searched_ > k - 1 ? searched_ - (k - 1) : 0;
+        auto match = kernel_(data + from, data + size, delim_.data(), k);
+        if (match)
+            return std::size_t(match - data) + k;
+        searched_ = size;
+        return 0;
+    }
+
+private:
+
+    std::string delim_;
+    detail::delimiter_search_kernel kernel_;
+    std::string carry_;
+    std::size_t searched_ = 0;
+};
+
+/// Search a buffer sequence for a delimiter.
+///
+/// @return the offset one past the end of the first occurrence of the delimiter, or 0 if there is none.
+template<class ConstBufferSequence>
+std::size_t
+search_delimiter(
+    ConstBufferSequence const &buffers,
+    string_view delimiter)
+{
+    return delimiter_search(delimiter).search(buffers);
+}
+
+}
+}
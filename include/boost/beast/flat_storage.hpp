@@ -1,124 +1,330 @@
 #pragma once
 
 #include <boost/beast/core/detail/config.hpp>
-#include <boost/beast/is_beast_v2_dynamic_buffer.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/growth_policy.hpp>
+#include <boost/beast/allocated_bytes.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <cstring>
+#include <limits>
+#include <memory>
 
 namespace boost {
 namespace beast {
+namespace detail {
+
+// bytes held within a flat storage, serving payloads which fit without allocating
+template<std::size_t N>
+class flat_inline_bytes
+{
+protected:
+    char *
+    inline_data() const
+    {
+        return bytes_;
+    }
+
+private:
+    mutable char bytes_[N];
+};
+
+template<>
+class flat_inline_bytes<0>
+{
+protected:
+    char *
+    inline_data() const
+    {
+        return nullptr;
+    }
+};
+
+}
 
 /// Opaque storage type for resizable buffer storage in layout of contiguous bytes
-struct flat_storage
+///
+/// Consumed bytes are not shifted out immediately. The readable bytes start at an offset into the
+/// allocation, and are moved back to the front only when grow() needs the space or when the consumed
+/// prefix exceeds the compaction threshold, a fraction of the capacity.
+///
+/// When a reallocation is needed, the new capacity is chosen by the GrowthPolicy (see growth_policy.hpp).
+/// Memory is obtained from the Allocator. Allocations and data moved by compaction are reported to the
+/// StatsPolicy (see storage_stats.hpp).
+///
+/// Up to InlineCapacity bytes are held within the storage object itself. The first allocation happens
+/// only when the data outgrows them, and shrink_to_fit() returns data which fits to them.
+template<
+    class GrowthPolicy = geometric_growth,
+    class Allocator = std::allocator<char>,
+    class StatsPolicy = no_storage_stats,
+    std::size_t InlineCapacity = 0>
+class basic_flat_storage
+    : public detail::with_storage_stats<StatsPolicy>
+    , private detail::flat_inline_bytes<InlineCapacity>
 {
-// interface
+    using this_class = basic_flat_storage<GrowthPolicy, Allocator, StatsPolicy, InlineCapacity>;
+
+    using bytes_type = allocated_bytes<Allocator>;
+
+public:
+    using allocator_type = Allocator;
+
+private:
+    // internal dynamic buffer interface
     using mutable_buffers_type = net::mutable_buffer;
     using const_buffers_type = net::const_buffer;
 
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    std::size_t
+    max_size() const
+    {
+        return max_size_;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return on_heap() ? store_.size() : InlineCapacity;
+    }
+
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+
+        return const_buffers_type(begin_data() + pos, n);
+    }
+
     mutable_buffers_type
-    prepare(std::size_t n)
+    data(std::size_t pos, std::size_t n)
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+
+        return mutable_buffers_type(begin_data() + pos, n);
+    }
+
+    void
+    grow(std::size_t n)
     {
-        if (capacity_ - size_ < n)
+        if (max_size_ - size_ < n)
+            boost::throw_exception(std::length_error("out of space"));
+
+        if (capacity() - start_ - size_ < n)
         {
-            auto new_cap = size_ + n;
-            if (new_cap > max_size_)
-                boost::throw_exception(std::length_error("out of space"));
-
-            auto oldp = store_.release();
-            auto newp = reinterpret_cast<char *>(std::realloc(oldp, new_cap));
-            if (newp)
-            {
-                store_.reset(newp);
-                capacity_ = new_cap;
-            }
+            if (capacity() - size_ >= n)
+                compact();
             else
-            {
-                store_.reset(oldp);
-                throw std::bad_alloc();
-            }
+                reallocate(growth_(capacity(), size_ + n, max_size_));
         }
-        auto result = mutable_buffers_type(store_.get() + size_, n);
         size_ += n;
-        return result;
+        this->stats_policy().on_resize(size_, capacity());
+    }
+
+    void
+    shrink(std::size_t n)
+    {
+        size_ -= std::min(n, size_);
     }
 
     void
     consume(std::size_t n)
     {
         n = std::min(n, size_);
-        std::memcpy(store_.get(), store_.get() + n, size_ - n);
+        start_ += n;
         size_ -= n;
+        if (size_ == 0)
+            start_ = 0;
+        else if (start_ > capacity() * compaction_threshold_)
+            compact();
+    }
+
+    friend beast_v2_dynamic_buffer_model<this_class>;
+
+// tuning
+public:
+    /// The fraction of the capacity which consumed bytes may occupy before consume() moves the
+    /// readable bytes to the front. 1.0 defers compaction until grow() needs the space.
+    double
+    compaction_threshold() const
+    {
+        return compaction_threshold_;
     }
 
     void
-    dispose_input(std::size_t n)
+    compaction_threshold(double fraction)
     {
-        size_ -= std::min(n, size_);
+        BOOST_ASSERT(fraction >= 0 && fraction <= 1);
+        compaction_threshold_ = fraction;
     }
 
-    const_buffers_type
-    data(std::size_t pos, std::size_t n) const
+    /// Ensure the capacity is at least n, allocating exactly n if it is not
+    void
+    reserve(std::size_t n)
     {
-        BOOST_ASSERT(pos < size_);
-        BOOST_ASSERT(n < size_ - pos);
+        if (n > max_size_)
+            boost::throw_exception(std::length_error("reserve"));
 
-        return const_buffers_type(store_.get(), n);
+        if (n > capacity())
+        {
+            reallocate(n);
+            this->stats_policy().on_resize(size_, capacity());
+        }
     }
 
-    mutable_buffers_type
-    data(std::size_t pos, std::size_t n)
+    /// Release the unused capacity, including any consumed prefix
+    void
+    shrink_to_fit()
     {
-        BOOST_ASSERT(pos < size_);
-        BOOST_ASSERT(n < size_ - pos);
+        if (size_ == 0)
+        {
+            store_.release();
+            start_ = 0;
+        }
+        else if (on_heap() && size_ < capacity())
+            reallocate(size_);
+    }
 
-        return mutable_buffers_type(store_.get(), n);
+    GrowthPolicy const &
+    growth_policy() const
+    {
+        return growth_;
     }
 
-    std::size_t
-    max_size() const
+    allocator_type
+    get_allocator() const
     {
-        return max_size_;
+        return store_.get_allocator();
     }
 
 // constructors
 public:
-    flat_storage(std::size_t limit = std::numeric_limits<std::size_t>::max())
-        : size_(0)
-        , capacity_(0)
+    basic_flat_storage(
+        std::size_t limit = std::numeric_limits<std::size_t>::max(),
+        GrowthPolicy growth = GrowthPolicy(),
+        Allocator const &alloc = Allocator())
+        : start_(0)
+        , size_(0)
         , max_size_(limit)
-        , store_(nullptr)
+        , compaction_threshold_(0.5)
+        , growth_(growth)
+        , store_(alloc)
+    {}
+
+    basic_flat_storage(
+        std::size_t limit,
+        Allocator const &alloc)
+        : basic_flat_storage(limit, GrowthPolicy(), alloc)
     {}
 
 private:
 
+    bool
+    on_heap() const
+    {
+        return store_.data() != nullptr;
+    }
+
+    char *
+    base() const
+    {
+        return on_heap() ? store_.data() : this->inline_data();
+    }
 
-    std::size_t size_;
-    std::size_t capacity_;
-    std::size_t max_size_;
+    char *
+    begin_data() const
+    {
+        return base() + start_;
+    }
 
-    struct deleter
+    void
+    compact()
+    {
+        std::memmove(base(), begin_data(), size_);
+        this->stats_policy().on_move(size_);
+        start_ = 0;
+    }
+
+    // move the readable bytes to the front of a new allocation, or back within the object if they fit
+    void
+    reallocate(std::size_t new_cap)
     {
-        void
-        operator()(char *p) const
+        if (InlineCapacity > 0 && new_cap <= InlineCapacity)
         {
-            std::free(p);
+            std::memmove(this->inline_data(), begin_data(), size_);
+            this->stats_policy().on_move(size_);
+            store_.release();
+            start_ = 0;
+            return;
         }
-    };
 
-    std::unique_ptr<char, deleter> store_;
+        auto fresh = bytes_type(new_cap, store_.get_allocator());
+        if (on_heap())
+            this->stats_policy().on_reallocate(new_cap);
+        else
+            this->stats_policy().on_allocate(new_cap);
+        if (size_)
+        {
+            std::memcpy(fresh.data(), begin_data(), size_);
+            this->stats_policy().on_move(size_);
+        }
+        store_ = std::move(fresh);
+        start_ = 0;
+    }
+
+    std::size_t start_;         // offset of the first readable byte
+    std::size_t size_;
+    std::size_t max_size_;
+    double compaction_threshold_;
+    GrowthPolicy growth_;
+    bytes_type store_;
 };
 
-struct flat_storage_dynamic_buffer
-    : beast_v2_dynamic_buffer_model<flat_storage>
+using flat_storage = basic_flat_storage<>;
+
+/// A flat_storage holding up to N bytes without allocating
+template<
+    std::size_t N,
+    class GrowthPolicy = geometric_growth,
+    class Allocator = std::allocator<char>>
+using small_flat_storage = basic_flat_storage<GrowthPolicy, Allocator, no_storage_stats, N>;
+
+#if BOOST_BEAST_HAS_STD_PMR
+namespace pmr {
+using flat_storage = basic_flat_storage<geometric_growth, std::pmr::polymorphic_allocator<char>>;
+}
+#endif
+
+template<
+    class GrowthPolicy,
+    class Allocator,
+    class StatsPolicy = no_storage_stats,
+    std::size_t InlineCapacity = 0>
+struct basic_flat_storage_dynamic_buffer
+    : beast_v2_dynamic_buffer_model<basic_flat_storage<GrowthPolicy, Allocator, StatsPolicy, InlineCapacity>>
 {
-    using beast_v2_dynamic_buffer_model::beast_v2_dynamic_buffer_model;
+    using base_class = beast_v2_dynamic_buffer_model<
+        basic_flat_storage<GrowthPolicy, Allocator, StatsPolicy, InlineCapacity>>;
+
+    using base_class::base_class;
 };
 
-inline auto
-dynamic_buffer(flat_storage &storage)
--> flat_storage_dynamic_buffer
+using flat_storage_dynamic_buffer = basic_flat_storage_dynamic_buffer<geometric_growth, std::allocator<char>>;
+
+template<class GrowthPolicy, class Allocator, class StatsPolicy, std::size_t InlineCapacity>
+auto
+dynamic_buffer(basic_flat_storage<GrowthPolicy, Allocator, StatsPolicy, InlineCapacity> &storage)
+-> basic_flat_storage_dynamic_buffer<GrowthPolicy, Allocator, StatsPolicy, InlineCapacity>
 {
     return {storage};
 }
 
 
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <algorithm>
+#include <cstddef>
+
+namespace boost {
+namespace beast {
+
+// A growth policy chooses the new capacity of a storage which must hold `required` bytes:
+//
+//     std::size_t operator()(std::size_t capacity, std::size_t required, std::size_t limit) const
+//
+// where capacity < required <= limit. The result must lie in [required, limit].
+
+/// Allocate exactly what is required
+struct exact_growth
+{
+    std::size_t
+    operator()(
+        std::size_t,
+        std::size_t required,
+        std::size_t) const
+    {
+        return required;
+    }
+};
+
+/// Multiply the capacity by a constant factor
+struct geometric_growth
+{
+    explicit geometric_growth(double factor = 2.0)
+        : factor_(factor)
+    {
+        BOOST_ASSERT(factor > 1.0);
+    }
+
+    std::size_t
+    operator()(
+        std::size_t capacity,
+        std::size_t required,
+        std::size_t limit) const
+    {
+        auto grown = capacity * factor_;
+        if (grown >= double(limit))
+            return limit;
+        return std::max(required, std::size_t(grown));
+    }
+
+    double
+    factor() const
+    {
+        return factor_;
+    }
+
+private:
+    double factor_;
+};
+
+/// Round the capacity chosen by another policy up to a whole number of pages
+template<class GrowthPolicy = geometric_growth>
+struct page_rounded_growth
+{
+    explicit page_rounded_growth(
+        std::size_t page_size = 4096,
+        GrowthPolicy policy = GrowthPolicy())
+        : page_size_(page_size)
+        , policy_(policy)
+    {
+        BOOST_ASSERT(page_size > 0);
+    }
+
+    std::size_t
+    operator()(
+        std::size_t capacity,
+        std::size_t required,
+        std::size_t limit) const
+    {
+        auto result = policy_(capacity, required, limit);
+        auto rem = result % page_size_;
+        if (rem == 0)
+            return result;
+        if (limit - result < page_size_ - rem)
+            return limit;
+        return result + (page_size_ - rem);
+    }
+
+private:
+    std::size_t page_size_;
+    GrowthPolicy policy_;
+};
+
+/// Go straight to the limit when the capacity chosen by another policy would leave less headroom
+/// below it than the growth just made, saving a final small reallocation
+template<class GrowthPolicy = geometric_growth>
+struct capped_growth
+{
+    explicit capped_growth(GrowthPolicy policy = GrowthPolicy())
+        : policy_(policy)
+    {}
+
+    std::size_t
+    operator()(
+        std::size_t capacity,
+        std::size_t required,
+        std::size_t limit) const
+    {
+        auto result = policy_(capacity, required, limit);
+        if (limit - result < result - capacity)
+            return limit;
+        return result;
+    }
+
+private:
+    GrowthPolicy policy_;
+};
+
+}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <cstddef>
+#include <new>
+
+namespace boost {
+namespace beast {
+
+/// Memory for the operation state of one connection's outstanding asynchronous operation.
+///
+/// Asio allocates the state of each operation it starts through the associated allocator of the
+/// completion handler, and frees it before invoking the handler. A connection which has one operation
+/// in flight at a time can therefore reuse a single block for all of them. Bind handler_memory_allocator
+/// to the handlers of the connection to do so; requests larger than the block, or made while it is in
+/// use, fall back to the heap.
+///
+/// The memory must outlive every operation using it. It is not thread safe: use it from one strand.
+class handler_memory
+{
+public:
+
+    static constexpr std::size_t capacity = 1024;
+
+    handler_memory() = default;
+    handler_memory(handler_memory const &) = delete;
+    handler_memory &operator=(handler_memory const &) = delete;
+
+    void *
+    allocate(std::size_t size)
+    {
+        ++allocations_;
+        if (!in_use_ && size <= capacity)
+        {
+            in_use_ = true;
+            return storage_;
+        }
+        ++fallbacks_;
+        return ::operator new(size);
+    }
+
+    void
+    deallocate(void *p)
+    {
+        if (p == storage_)
+            in_use_ = false;
+        else
+            ::operator delete(p);
+    }
+
+    /// The number of allocations made through this memory
+    std::size_t
+    allocations() const
+    {
+        return allocations_;
+    }
+
+    /// The number of those allocations which did not fit and were made on the heap
+    std::size_t
+    fallbacks() const
+    {
+        return fallbacks_;
+    }
+
+private:
+
+    alignas(std::max_align_t) unsigned char storage_[capacity];
+    bool in_use_ = false;
+    std::size_t allocations_ = 0;
+    std::size_t fallbacks_ = 0;
+};
+
+/// Allocator drawing from a handler_memory, for use as the associated allocator of a handler
+template<class T>
+class handler_memory_allocator
+{
+public:
+
+    using value_type = T;
+
+    explicit
+    handler_memory_allocator(handler_memory &memory) noexcept
+        : memory_(&memory)
+    {}
+
+    template<class U>
+    handler_memory_allocator(handler_memory_allocator<U> const &other) noexcept
+        : memory_(other.memory_)
+    {}
+
+    T *
+    allocate(std::size_t n)
+    {
+        return static_cast<T *>(memory_->allocate(sizeof(T) * n));
+    }
+
+    void
+    deallocate(T *p, std::size_t)
+    {
+        memory_->deallocate(p);
+    }
+
+    template<class U>
+    friend bool
+    operator==(handler_memory_allocator const &a, handler_memory_allocator<U> const &b) noexcept
+    {
+        return a.memory_ == b.memory_;
+    }
+
+    template<class U>
+    friend bool
+    operator!=(handler_memory_allocator const &a, handler_memory_allocator<U> const &b) noexcept
+    {
+        return a.memory_ != b.memory_;
+    }
+
+private:
+
+    template<class>
+    friend class handler_memory_allocator;
+
+    handler_memory *memory_;
+};
+
+}
+}
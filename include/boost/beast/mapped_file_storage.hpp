@@ -0,0 +1,357 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if defined(__linux__)
+#define BOOST_BEAST_HAS_MAPPED_FILE_STORAGE 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+
+namespace boost {
+namespace beast {
+
+/// Opaque storage type for resizable buffer storage in a memory mapped file
+///
+/// Readable bytes lie at increasing offsets in the file, which is mapped whole, so data() is always a
+/// single buffer. grow() extends the file with ftruncate, at least doubling it so that it is extended
+/// rarely, and extends the mapping with mremap, which may move it. Data read into the storage goes
+/// straight to the page cache.
+///
+/// consume() only advances an index. Whole consumed pages are punched out of the file, which frees
+/// their blocks and their page cache. When grow() needs to extend the file while the consumed bytes
+/// outnumber the readable ones, it moves the readable bytes back to the front instead, so a stream
+/// keeps a file of a few times its readable bytes, however many pass through it.
+///
+/// The blocks of the file are allocated before the storage writes to them: when the file is extended,
+/// and again for the punched pages before the readable bytes move back over them. A full file system
+/// makes grow() throw system_error, rather than a write through the mapping raise SIGBUS.
+///
+/// On destruction the file is truncated to the end of the readable bytes. Extensions of the file and
+/// bytes moved by compaction are reported to the StatsPolicy (see storage_stats.hpp).
+template<class StatsPolicy = no_storage_stats>
+class basic_mapped_file_storage
+    : public detail::with_storage_stats<StatsPolicy>
+{
+    using this_class = basic_mapped_file_storage<StatsPolicy>;
+
+private:
+    // internal dynamic buffer interface
+    using mutable_buffers_type = net::mutable_buffer;
+    using const_buffers_type = net::const_buffer;
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    std::size_t
+    max_size() const
+    {
+        return max_size_;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return mapped_ - start_;
+    }
+
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        return const_buffers_type(base_ + start_ + pos, n);
+    }
+
+    mutable_buffers_type
+    data(std::size_t pos, std::size_t n)
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        return mutable_buffers_type(base_ + start_ + pos, n);
+    }
+
+    void
+    grow(std::size_t n)
+    {
+        if (max_size_ - size_ < n)
+            boost::throw_exception(std::length_error("out of space"));
+
+        if (mapped_ - start_ - size_ < n && start_ > size_)
+            compact();
+        if (mapped_ - start_ - size_ < n)
+            extend(start_ + size_ + n);
+        size_ += n;
+        this->stats_policy().on_resize(size_, capacity());
+    }
+
+    void
+    shrink(std::size_t n)
+    {
+        size_ -= std::min(n, size_);
+    }
+
+    void
+    consume(std::size_t n)
+    {
+        n = std::min(n, size_);
+        size_ -= n;
+        start_ += n;
+        drop_consumed_pages();
+    }
+
+    friend beast_v2_dynamic_buffer_model<this_class>;
+
+// constructors
+public:
+    static constexpr std::size_t default_limit = std::size_t(1) << 30;
+
+    /// Store bytes in the file at path, which is created, or truncated if it exists
+    explicit
+    basic_mapped_file_storage(
+        char const *path,
+        std::size_t limit = default_limit)
+        : basic_mapped_file_storage(open_file(path), limit)
+    {}
+
+    /// Store bytes in an unlinked temporary file in directory, which is removed once the storage is
+    /// destroyed. The default is /var/tmp rather than /tmp, which is often a tmpfs, where the bytes
+    /// would be held in memory or swap.
+    static
+    basic_mapped_file_storage
+    temporary(
+        char const *directory = "/var/tmp",
+        std::size_t limit = default_limit)
+    {
+        return basic_mapped_file_storage(open_temporary(directory), limit);
+    }
+
+    basic_mapped_file_storage(basic_mapped_file_storage &&other) noexcept
+        : detail::with_storage_stats<StatsPolicy>(other.stats())
+        , fd_(other.fd_)
+        , base_(other.base_)
+        , mapped_(other.mapped_)
+        , dropped_(other.dropped_)
+        , max_size_(other.max_size_)
+        , start_(other.start_)
+        , size_(other.size_)
+    {
+        other.fd_ = -1;
+        other.base_ = nullptr;
+        other.mapped_ = 0;
+        other.dropped_ = 0;
+        other.max_size_ = 0;
+        other.start_ = 0;
+        other.size_ = 0;
+    }
+
+    basic_mapped_file_storage(basic_mapped_file_storage const &) = delete;
+
+    basic_mapped_file_storage &
+    operator=(basic_mapped_file_storage const &) = delete;
+
+    ~basic_mapped_file_storage()
+    {
+        if (base_)
+            ::munmap(base_, mapped_);
+        if (fd_ >= 0)
+        {
+            if (::ftruncate(fd_, off_t(start_ + size_)) != 0)
+            {
+                // nothing can be reported from a destructor; the file keeps its padding
+            }
+            ::close(fd_);
+        }
+    }
+
+    /// The file descriptor of the file
+    int
+    native_handle() const
+    {
+        return fd_;
+    }
+
+private:
+
+    // store bytes in the open file fd, which the storage closes, after truncating it to zero length
+    basic_mapped_file_storage(
+        int fd,
+        std::size_t limit)
+        : fd_(fd)
+        , max_size_(limit)
+    {
+        if (::ftruncate(fd_, 0) != 0)
+            fail_and_close("ftruncate");
+    }
+
+    [[noreturn]] static
+    void
+    fail(char const *what)
+    {
+        boost::throw_exception(system_error(error_code(errno, system::generic_category()), what));
+    }
+
+    static
+    std::size_t
+    page_size()
+    {
+        static auto const page = std::size_t(::sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+    static
+    std::size_t
+    round_to_pages(std::size_t n)
+    {
+        return (n + page_size() - 1) / page_size() * page_size();
+    }
+
+    static
+    int
+    open_file(char const *path)
+    {
+        auto fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+            fail("open");
+        return fd;
+    }
+
+    static
+    int
+    open_temporary(char const *directory)
+    {
+#ifdef O_TMPFILE
+        {
+            auto fd = ::open(directory, O_RDWR | O_TMPFILE | O_CLOEXEC, 0600);
+            if (fd >= 0)
+                return fd;
+        }
+#endif
+        // the file system does not support O_TMPFILE: create a named file and unlink it at once
+        std::string path(directory);
+        path += "/beast-XXXXXX";
+        auto fd = ::mkostemp(&path[0], O_CLOEXEC);
+        if (fd < 0)
+            fail("mkostemp");
+        ::unlink(path.c_str());
+        return fd;
+    }
+
+    [[noreturn]]
+    void
+    fail_and_close(char const *what)
+    {
+        auto e = errno;
+        ::close(fd_);
+        errno = e;
+        fail(what);
+    }
+
+    // extend the file and its mapping to hold at least `end` bytes
+    void
+    extend(std::size_t end)
+    {
+        // grow() compacts first, so the end never passes twice the limit
+        auto most = max_size_ > std::numeric_limits<std::size_t>::max() / 4 ? max_size_ : 2 * max_size_;
+        auto length = round_to_pages(std::min(std::max(end, 2 * mapped_), std::max(most, end)));
+        if (::ftruncate(fd_, off_t(length)) != 0)
+            fail("ftruncate");
+        if (auto ec = ::posix_fallocate(fd_, off_t(mapped_), off_t(length - mapped_)))
+        {
+            if (::ftruncate(fd_, off_t(mapped_)) != 0)
+            {
+                // the file keeps its unreserved tail, which the storage does not write to
+            }
+            boost::throw_exception(system_error(error_code(ec, system::generic_category()), "posix_fallocate"));
+        }
+
+        auto mapped = base_
+            ? ::mremap(base_, mapped_, length, MREMAP_MAYMOVE)
+            : ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapped == MAP_FAILED)
+            fail(base_ ? "mremap" : "mmap");
+        if (base_)
+            this->stats_policy().on_reallocate(length);
+        else
+            this->stats_policy().on_allocate(length);
+        base_ = static_cast<char *>(mapped);
+        mapped_ = length;
+        ::madvise(base_, mapped_, MADV_SEQUENTIAL);
+    }
+
+    // move the readable bytes to the front of the file, over pages which may have been punched
+    void
+    compact()
+    {
+        if (dropped_)
+            if (auto ec = ::posix_fallocate(fd_, 0, off_t(dropped_)))
+                boost::throw_exception(system_error(error_code(ec, system::generic_category()), "posix_fallocate"));
+        std::memmove(base_, base_ + start_, size_);
+        this->stats_policy().on_move(size_);
+        start_ = 0;
+        dropped_ = 0;
+    }
+
+    // free the blocks and page cache of whole consumed pages. Where the file system cannot punch
+    // holes, the pages are only dropped from the mapping and stay in the file until it is compacted.
+    void
+    drop_consumed_pages()
+    {
+        auto whole = start_ / page_size() * page_size();
+        if (whole > dropped_)
+        {
+            if (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off_t(dropped_),
+                            off_t(whole - dropped_)) != 0)
+                ::madvise(base_ + dropped_, whole - dropped_, MADV_DONTNEED);
+            dropped_ = whole;
+        }
+    }
+
+    int fd_;
+    char *base_ = nullptr;
+    std::size_t mapped_ = 0;        // length of the file, all of it mapped at base_
+    std::size_t dropped_ = 0;       // consumed bytes at the front punched out of the file
+    std::size_t max_size_;
+    std::size_t start_ = 0;         // offset in the file of the first readable byte
+    std::size_t size_ = 0;
+};
+
+using mapped_file_storage = basic_mapped_file_storage<>;
+
+template<class StatsPolicy = no_storage_stats>
+struct basic_mapped_file_storage_dynamic_buffer
+    : beast_v2_dynamic_buffer_model<basic_mapped_file_storage<StatsPolicy>>
+{
+    using base_class = beast_v2_dynamic_buffer_model<basic_mapped_file_storage<StatsPolicy>>;
+
+    using base_class::base_class;
+};
+
+using mapped_file_storage_dynamic_buffer = basic_mapped_file_storage_dynamic_buffer<>;
+
+template<class StatsPolicy>
+auto
+dynamic_buffer(basic_mapped_file_storage<StatsPolicy> &storage)
+-> basic_mapped_file_storage_dynamic_buffer<StatsPolicy>
+{
+    return {storage};
+}
+
+}
+}
+
+#endif
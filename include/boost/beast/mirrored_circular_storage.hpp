@@ -0,0 +1,235 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/storage_stats.hpp>
+
+#if defined(__linux__)
+#define BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE 1
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+
+namespace boost {
+namespace beast {
+
+/// Opaque storage type for bounded buffer storage in circular layout, which is always contiguous
+///
+/// The "magic ring" mode of circular_storage: the same memfd-backed pages are mapped twice, back to
+/// back, so a region which wraps around the end of the ring continues seamlessly into the second
+/// mapping. data() always returns a single buffer and consume() only advances an index.
+///
+/// The capacity is the limit rounded up to a whole number of pages; max_size() is the limit. The
+/// mapping is reported to the StatsPolicy as an allocation (see storage_stats.hpp).
+template<class StatsPolicy = no_storage_stats>
+class basic_mirrored_circular_storage
+    : public detail::with_storage_stats<StatsPolicy>
+{
+    using this_class = basic_mirrored_circular_storage<StatsPolicy>;
+
+public:
+    /// grow() never moves the readable bytes
+    static constexpr bool stable_growth = true;
+
+private:
+    // internal dynamic buffer interface
+    using mutable_buffers_type = net::mutable_buffer;
+    using const_buffers_type = net::const_buffer;
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    std::size_t
+    max_size() const
+    {
+        return max_size_;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return capacity_;
+    }
+
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        return const_buffers_type(base_ + start_ + pos, n);
+    }
+
+    mutable_buffers_type
+    data(std::size_t pos, std::size_t n)
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        return mutable_buffers_type(base_ + start_ + pos, n);
+    }
+
+    void
+    grow(std::size_t n)
+    {
+        if (max_size_ - size_ < n)
+            boost::throw_exception(std::length_error("out of space"));
+
+        size_ += n;
+        this->stats_policy().on_resize(size_, capacity_);
+    }
+
+    void
+    shrink(std::size_t n)
+    {
+        size_ -= std::min(n, size_);
+    }
+
+    void
+    consume(std::size_t n)
+    {
+        n = std::min(n, size_);
+        size_ -= n;
+        start_ += n;
+        if (start_ >= capacity_)
+            start_ -= capacity_;
+    }
+
+    friend beast_v2_dynamic_buffer_model<this_class>;
+
+// constructors
+public:
+    explicit
+    basic_mirrored_circular_storage(std::size_t limit)
+        : base_(nullptr)
+        , capacity_(round_to_pages(limit))
+        , max_size_(limit)
+        , start_(0)
+        , size_(0)
+    {
+        map();
+        this->stats_policy().on_allocate(capacity_);
+    }
+
+    basic_mirrored_circular_storage(basic_mirrored_circular_storage &&other) noexcept
+        : detail::with_storage_stats<StatsPolicy>(other.stats())
+        , base_(other.base_)
+        , capacity_(other.capacity_)
+        , max_size_(other.max_size_)
+        , start_(other.start_)
+        , size_(other.size_)
+    {
+        other.base_ = nullptr;
+        other.capacity_ = 0;
+        other.max_size_ = 0;
+        other.start_ = 0;
+        other.size_ = 0;
+    }
+
+    basic_mirrored_circular_storage(basic_mirrored_circular_storage const &) = delete;
+
+    basic_mirrored_circular_storage &
+    operator=(basic_mirrored_circular_storage const &) = delete;
+
+    ~basic_mirrored_circular_storage()
+    {
+        if (base_)
+            ::munmap(base_, 2 * capacity_);
+    }
+
+private:
+
+    static
+    std::size_t
+    round_to_pages(std::size_t n)
+    {
+        auto page = std::size_t(::sysconf(_SC_PAGESIZE));
+        if (n == 0)
+            return page;
+        return (n + page - 1) / page * page;
+    }
+
+    [[noreturn]] static
+    void
+    fail(char const *what)
+    {
+        boost::throw_exception(system_error(error_code(errno, system::generic_category()), what));
+    }
+
+    void
+    map()
+    {
+        auto fd = ::memfd_create("beast-mirrored-ring", MFD_CLOEXEC);
+        if (fd < 0)
+            fail("memfd_create");
+
+        struct fd_closer
+        {
+            int fd;
+
+            ~fd_closer()
+            {
+                ::close(fd);
+            }
+        } closer{fd};
+
+        if (::ftruncate(fd, off_t(capacity_)) != 0)
+            fail("ftruncate");
+
+        // reserve address space for both views, then map the file over each half
+        auto reserved = ::mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+            fail("mmap");
+
+        auto base = static_cast<char *>(reserved);
+        for (auto half : {base, base + capacity_})
+        {
+            if (::mmap(half, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+            {
+                auto e = errno;
+                ::munmap(reserved, 2 * capacity_);
+                errno = e;
+                fail("mmap");
+            }
+        }
+        base_ = base;
+    }
+
+    char *base_;
+    std::size_t capacity_;
+    std::size_t max_size_;
+    std::size_t start_;         // index of the first readable byte, always less than capacity_
+    std::size_t size_;
+};
+
+using mirrored_circular_storage = basic_mirrored_circular_storage<>;
+
+template<class StatsPolicy = no_storage_stats>
+struct basic_mirrored_circular_storage_dynamic_buffer
+    : beast_v2_dynamic_buffer_model<basic_mirrored_circular_storage<StatsPolicy>>
+{
+    using base_class = beast_v2_dynamic_buffer_model<basic_mirrored_circular_storage<StatsPolicy>>;
+
+    using base_class::base_class;
+};
+
+using mirrored_circular_storage_dynamic_buffer = basic_mirrored_circular_storage_dynamic_buffer<>;
+
+template<class StatsPolicy>
+auto
+dynamic_buffer(basic_mirrored_circular_storage<StatsPolicy> &storage)
+-> basic_mirrored_circular_storage_dynamic_buffer<StatsPolicy>
+{
+    return {storage};
+}
+
+
+}
+}
+
+#endif
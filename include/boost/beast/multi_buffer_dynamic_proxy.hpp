@@ -3,7 +3,12 @@
 #include <boost/beast/core/detail/config.hpp>
 #include <boost/beast/core/multi_buffer.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/optional/optional.hpp>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <type_traits>
 
 namespace boost {
@@ -13,56 +18,409 @@ class multi_buffer_dynamic_proxy_base
 {
 public:
 
-    using mutable_buffers_type = std::vector<net::mutable_buffer>;
+    /// Cumulative-offset index over the readable chunks of a multi_buffer.
+    /// Offsets are absolute: they count every byte ever committed through the index, so consuming
+    /// from the front only moves base_ and never rewrites the entries. Up to inline_chunks entries are
+    /// held without allocating.
+    class chunk_index
+    {
+    public:
 
-    using const_buffers_type = std::vector<net::const_buffer>;
+        static constexpr std::size_t inline_chunks = 8;
 
-protected:
+        struct entry
+        {
+            net::mutable_buffer buffer;
+            std::size_t end;            // absolute offset one past the last byte of buffer
 
-    // internal utilities
-    template<class BufferSequence>
-    static void
-    trim(
-        BufferSequence& sequence,
-        std::size_t pos,
-        std::size_t n)
-    {
-        auto current = sequence.begin();
-        // trim up to pos
-        for (; pos && current != sequence.end();)
+            std::size_t
+            start() const
+            {
+                return end - buffer.size();
+            }
+        };
+
+        using const_iterator = entry const *;
+
+        const_iterator
+        begin() const
+        {
+            return entries_.data() + head_;
+        }
+
+        const_iterator
+        end() const
+        {
+            return entries_.data() + entries_.size();
+        }
+
+        /// Absolute offset of the first readable byte
+        std::size_t
+        base() const
         {
-            if (current->size() <= pos)
+            return base_;
+        }
+
+        std::size_t
+        size() const
+        {
+            return begin() == end() ? 0 : entries_.back().end - base_;
+        }
+
+        /// The first chunk containing bytes at or after the absolute offset pos
+        const_iterator
+        find(std::size_t pos) const
+        {
+            return std::upper_bound(begin(), end(), pos, [](std::size_t p, entry const &e)
             {
-                pos -= current->size();
-                current = sequence.erase(current);
+                return p < e.end;
+            });
+        }
+
+        /// True if the index describes exactly the readable bytes in the buffer sequence
+        template<class BufferSequence>
+        bool
+        describes(BufferSequence const &readable, std::size_t size) const
+        {
+            if (size != this->size())
+                return false;
+            if (size == 0)
+                return true;
+
+            auto first = net::mutable_buffer(*net::buffer_sequence_begin(readable));
+            auto last = net::mutable_buffer(*std::prev(net::buffer_sequence_end(readable)));
+            auto const &back = entries_.back();
+            return first.data() == static_cast<char *>(begin()->buffer.data()) + (base_ - begin()->start())
+                   && static_cast<char *>(last.data()) + last.size()
+                      == static_cast<char *>(back.buffer.data()) + back.buffer.size();
+        }
+
+        template<class BufferSequence>
+        void
+        rebuild(BufferSequence const &readable)
+        {
+            entries_.clear();
+            head_ = 0;
+            base_ = 0;
+            append(readable, std::numeric_limits<std::size_t>::max());
+        }
+
+        /// Index the first n bytes of the buffer sequence as newly committed data
+        template<class BufferSequence>
+        void
+        append(BufferSequence const &buffers, std::size_t n)
+        {
+            for (auto it = net::buffer_sequence_begin(buffers); n && it != net::buffer_sequence_end(buffers); ++it)
+            {
+                auto buf = net::mutable_buffer(*it);
+                buf = net::mutable_buffer(buf.data(), std::min(buf.size(), n));
+                n -= buf.size();
+                if (buf.size() == 0)
+                    continue;
+
+                // chunks which continue the previous one in memory are merged, so committing part of a
+                // prepared region does not fragment the index
+                if (begin() != end())
+                {
+                    auto &back = entries_.back();
+                    if (static_cast<char *>(back.buffer.data()) + back.buffer.size() == buf.data())
+                    {
+                        back.buffer = net::mutable_buffer(back.buffer.data(), back.buffer.size() + buf.size());
+                        back.end += buf.size();
+                        continue;
+                    }
+                }
+                auto end = entries_.empty() ? base_ : entries_.back().end;
+                entries_.push_back(entry{buf, end + buf.size()});
             }
-            else
+        }
+
+        void
+        consume(std::size_t n)
+        {
+            base_ += std::min(n, size());
+            head_ = std::size_t(find(base_) - entries_.data());
+            if (head_ == entries_.size())
+            {
+                entries_.clear();
+                head_ = 0;
+            }
+            else if (head_ > entries_.size() / 2)
             {
-                *current += pos;
-                pos = 0;
+                entries_.erase(entries_.begin(), entries_.begin() + head_);
+                head_ = 0;
             }
         }
 
-        // current_buffer now contains the first buffer that contains data we are interested in
+    private:
+
+        boost::container::small_vector<entry, inline_chunks> entries_;
+        std::size_t head_ = 0;      // first live entry
+        std::size_t base_ = 0;
+    };
+
+    /// Lazy buffer sequence describing a window of the readable bytes of a multi_buffer followed by
+    /// its prepared region. The start of the window is found in a chunk_index by binary search, and
+    /// the chunks it covers are copied into the window, so that it stays valid after the proxy which
+    /// made it is moved or destroyed, until the multi_buffer changes. The window is applied as each
+    /// buffer is dereferenced. Nothing is allocated for a window covering up to inline_chunks chunks.
+    /// Positions are absolute offsets in the index.
+    ///
+    /// The search is O(log chunks) only while the index is current: the first use of a new proxy,
+    /// or of one whose multi_buffer was changed elsewhere, rebuilds the index in O(chunks).
+    template<class Range, class BufferType>
+    class buffers_window
+    {
+        using chunk_iterator = chunk_index::const_iterator;
+        using range_iterator = typename Range::const_iterator;
+
+    public:
+
+        using value_type = BufferType;
 
-        // insert up to n
-        for ( ; current != sequence.end() ; )
+        class const_iterator
         {
-            if (current->size() < n)
+            friend buffers_window;
+
+            // part_ is what is currently being visited: 0 = indexed readable chunks,
+            // 1 = prepared region, 2 = end of sequence
+            buffers_window const *window_ = nullptr;
+            int part_ = 2;
+            chunk_iterator chunk_ = nullptr;
+            range_iterator it_;
+            std::size_t offset_ = 0;   // absolute offset of *it_ while in the prepared region
+
+            const_iterator(
+                buffers_window const &window,
+                int part)
+                : window_(std::addressof(window))
+                , part_(part)
+            {}
+
+            std::size_t
+            start() const
             {
-                ++current;
+                return part_ == 0 ? chunk_->start() : offset_;
             }
-            else
+
+            BufferType
+            whole() const
+            {
+                return part_ == 0 ? BufferType(chunk_->buffer) : BufferType(*it_);
+            }
+
+            void
+            enter_prepared()
+            {
+                if (window_->prepared_.has_value())
+                {
+                    part_ = 1;
+                    it_ = window_->prepared_->begin();
+                    offset_ = window_->committed_end_;
+                    settle();
+                }
+                else
+                    part_ = 2;
+            }
+
+            // leave the prepared region when it is exhausted and the whole sequence when the window is
+            void
+            settle()
+            {
+                if (part_ == 1 && it_ == window_->prepared_->end())
+                    part_ = 2;
+                if (part_ < 2 && start() >= window_->end_)
+                    part_ = 2;
+            }
+
+            void
+            step_back()
+            {
+                if (part_ == 2)
+                {
+                    if (window_->prepared_.has_value() && window_->end_ > window_->committed_end_)
+                    {
+                        part_ = 1;
+                        it_ = window_->prepared_->end();
+                        offset_ = window_->committed_end_ + net::buffer_size(*window_->prepared_);
+                    }
+                    else
+                    {
+                        // the chunk containing the last byte of the window
+                        part_ = 0;
+                        chunk_ = std::lower_bound(
+                            window_->first(), window_->last(), window_->end_,
+                            [](chunk_index::entry const &e, std::size_t p)
+                            {
+                                return e.end < p;
+                            });
+                        if (chunk_ != window_->last())
+                            ++chunk_;
+                    }
+                }
+                if (part_ == 1 && it_ == window_->prepared_->begin())
+                {
+                    part_ = 0;
+                    chunk_ = window_->last();
+                }
+                if (part_ == 1)
+                {
+                    --it_;
+                    offset_ -= value_type(*it_).size();
+                }
+                else
+                {
+                    BOOST_ASSERT(chunk_ != window_->first());
+                    --chunk_;
+                }
+            }
+
+        public:
+            using value_type = BufferType;
+            using pointer = value_type const *;
+            using reference = value_type;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            const_iterator() = default;
+
+            bool
+            operator==(const_iterator const &other) const
+            {
+                if (part_ != other.part_)
+                    return false;
+                if (part_ == 0)
+                    return chunk_ == other.chunk_;
+                return part_ == 2 || it_ == other.it_;
+            }
+
+            bool
+            operator!=(const_iterator const &other) const
+            {
+                return !(*this == other);
+            }
+
+            reference
+            operator*() const
+            {
+                auto buf = whole();
+                auto offset = start();
+                auto first = std::max(offset, window_->pos_);
+                auto last = std::min(offset + buf.size(), window_->end_);
+                buf += first - offset;
+                return value_type(buf.data(), last - first);
+            }
+
+            pointer
+            operator->() const = delete;
+
+            const_iterator &
+            operator++()
             {
-                using buffer_type = typename std::decay<decltype(*current)>::type;
-                *current = buffer_type{current->data(), n};
-                ++current;
-                n = 0;
+                if (part_ == 0)
+                {
+                    if (++chunk_ == window_->last())
+                        enter_prepared();
+                    else
+                        settle();
+                }
+                else
+                {
+                    offset_ += value_type(*it_).size();
+                    ++it_;
+                    settle();
+                }
+                return *this;
+            }
+
+            const_iterator
+            operator++(int)
+            {
+                auto temp = *this;
+                ++(*this);
+                return temp;
+            }
+
+            const_iterator &
+            operator--()
+            {
+                step_back();
+                while (start() >= window_->end_)
+                    step_back();
+                return *this;
             }
+
+            const_iterator
+            operator--(int)
+            {
+                auto temp = *this;
+                --(*this);
+                return temp;
+            }
+        };
+
+        const_iterator
+        begin() const
+        {
+            if (end_ == pos_)
+                return end();
+
+            auto result = const_iterator(*this, 0);
+            result.chunk_ = first();
+            if (first() == last())
+            {
+                result.enter_prepared();
+                while (result.part_ == 1 && result.offset_ + value_type(*result.it_).size() <= pos_)
+                    ++result;
+            }
+            else
+                result.settle();
+            return result;
         }
 
-        sequence.erase(current, sequence.end());
-    }
+        const_iterator
+        end() const
+        {
+            return const_iterator(*this, 2);
+        }
+
+    public:
+
+        buffers_window(
+            chunk_index const &index,
+            optional<Range> const &prepared,
+            std::size_t pos,
+            std::size_t n)
+            : prepared_(prepared)
+            , committed_end_(index.base() + index.size())
+            , pos_(index.base() + pos)
+            , end_(pos_ + std::min(n, std::numeric_limits<std::size_t>::max() - pos_))
+        {
+            for (auto it = index.find(pos_); it != index.end() && it->start() < end_; ++it)
+                chunks_.push_back(*it);
+        }
+
+    private:
+
+        chunk_iterator
+        first() const
+        {
+            return chunks_.data();
+        }
+
+        chunk_iterator
+        last() const
+        {
+            return chunks_.data() + chunks_.size();
+        }
+
+        // the indexed chunks holding bytes of the window
+        boost::container::small_vector<chunk_index::entry, chunk_index::inline_chunks> chunks_;
+        optional<Range> prepared_;
+        std::size_t committed_end_;
+        std::size_t pos_;
+        std::size_t end_;
+    };
 };
 
 template<class Allocator>
@@ -70,12 +428,24 @@ class multi_buffer_dynamic_proxy : public multi_buffer_dynamic_proxy_base
 {
     using storage_type = basic_multi_buffer<Allocator>;
 
+    using range_type = typename storage_type::mutable_buffers_type;
+
     storage_type *storage_;
 
     // optionally the region that was last prepared
-    optional<typename storage_type::mutable_buffers_type> prepared_region_;
+    optional<range_type> prepared_region_;
+
+    // held by value, so that making a proxy for each operation allocates nothing for a short chain.
+    // A copy which changes the buffer, like one held by a composed operation, leaves this one stale
+    // until its next use rebuilds it.
+    mutable chunk_index index_;
 
 public:
+
+    using mutable_buffers_type = buffers_window<range_type, net::mutable_buffer>;
+
+    using const_buffers_type = buffers_window<range_type, net::const_buffer>;
+
     // constructor
     multi_buffer_dynamic_proxy(storage_type &store)
         : storage_(std::addressof(store))
@@ -107,29 +477,7 @@ public:
         std::size_t pos,
         std::size_t n) const
     {
-        auto result = const_buffers_type();
-        for(auto&& buf : storage_->data())
-        {
-            if (buf.size())
-            {
-                result.emplace_back(buf.data(), buf.size());
-            }
-        }
-
-        if (prepared_region_.has_value())
-        {
-            for(auto&& buf : *prepared_region_)
-            {
-                if (buf.size())
-                {
-                    result.emplace_back(buf.data(), buf.size());
-                }
-            }
-        }
-
-        trim(result, pos, n);
-
-        return result;
+        return const_buffers_type(index(), prepared_region_, pos, n);
     }
 
     auto
@@ -138,29 +486,7 @@ public:
         std::size_t n)
     -> mutable_buffers_type
     {
-        auto result = mutable_buffers_type();
-        for(auto&& buf : storage_->data())
-        {
-            if (buf.size())
-            {
-                result.emplace_back(buf.data(), buf.size());
-            }
-        }
-
-        if (prepared_region_.has_value())
-        {
-            for(auto&& buf : *prepared_region_)
-            {
-                if (buf.size())
-                {
-                    result.emplace_back(buf.data(), buf.size());
-                }
-            }
-        }
-
-        trim(result, pos, n);
-
-        return result;
+        return mutable_buffers_type(index(), prepared_region_, pos, n);
     }
 
     void
@@ -178,20 +504,70 @@ public:
     shrink(std::size_t n)
     {
         BOOST_ASSERT(prepared_region_.has_value());
+        auto &idx = index();
         auto commit_size = net::buffer_size(*prepared_region_) - n;
         storage_->commit(commit_size);
+        idx.append(*prepared_region_, commit_size);
         prepared_region_.reset();
     }
 
     void
     consume(std::size_t n)
     {
-        return storage_->consume(n);
+        auto &idx = index();
+        storage_->consume(n);
+        idx.consume(n);
+    }
+
+    /// Move the first n readable bytes of source, or all of them if it holds fewer, to the end of this
+    /// buffer, and return how many were moved.
+    ///
+    /// basic_multi_buffer does not give access to its chunks, so the bytes move without being copied
+    /// only when all of source moves into an empty buffer, by moving the multi_buffer itself. Otherwise
+    /// they are copied. Throws std::length_error if the bytes would exceed max_size().
+    std::size_t
+    splice(
+        multi_buffer_dynamic_proxy &source,
+        std::size_t n)
+    {
+        BOOST_ASSERT(!prepared_region_.has_value() && !source.prepared_region_.has_value());
+
+        n = std::min(n, source.size());
+        if (n == 0 || source.storage_ == storage_)
+            return 0;
+        if (size() + n > max_size())
+            throw std::length_error("splice");
+
+        if (size() == 0 && n == source.size())
+        {
+            // move assignment takes the source's limit as well as its chunks
+            auto limit = storage_->max_size();
+            *storage_ = std::move(*source.storage_);
+            storage_->max_size(limit);
+            return n;
+        }
+
+        auto &idx = index();
+        auto region = storage_->prepare(n);
+        net::buffer_copy(region, source.data(0, n));
+        storage_->commit(n);
+        idx.append(region, n);
+        source.consume(n);
+        return n;
     }
 
 private:
 
+    // the index, rebuilt if the multi_buffer was modified other than through this proxy
+    chunk_index &
+    index() const
+    {
+        auto readable = storage_->data();
+        if (!index_.describes(readable, storage_->size()))
+            index_.rebuild(readable);
 
+        return index_;
+    }
 };
 
 
@@ -207,4 +583,4 @@ dynamic_buffer(basic_multi_buffer <Allocator> &storage)
 
 
 }
-}
\ No newline at end of file
+}
@@ -1,148 +1,638 @@
 #pragma once
 
 #include <boost/beast/core/detail/config.hpp>
-#include <boost/beast/is_beast_v2_dynamic_buffer.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/allocated_bytes.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <boost/core/empty_value.hpp>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
 
 namespace boost {
 namespace beast {
 
+namespace detail {
+
+struct multi_storage_chunk
+{
+    multi_storage_chunk *prev;
+    multi_storage_chunk *next;
+    std::size_t capacity;   // bytes of storage following the header
+    std::size_t used;       // end offset of the bytes in use
+
+    char *
+    bytes()
+    {
+        return reinterpret_cast<char *>(this + 1);
+    }
+};
+
+}
+
 /// Opaque storage type for resizable buffer storage in layout of chunks of bytes
-struct multi_storage
+///
+/// Bytes are held in a doubly linked list of chunks whose sizes are drawn from a few fixed size classes.
+/// grow() fills the last chunk before appending new ones and consume() releases chunks from the front,
+/// so both are O(1) per chunk touched. The size is cached. One released chunk is kept as a spare to
+/// absorb the grow/shrink churn of a read loop.
+///
+/// Chunks are obtained from the Allocator, rebound to the chunk header type.
+template<
+    class Allocator = std::allocator<char>,
+    class StatsPolicy = no_storage_stats>
+class basic_multi_storage
+    : private boost::empty_value<Allocator>
+    , public detail::with_storage_stats<StatsPolicy>
 {
-    // for now, implement in terms of multi_buffer. This can be optimised later
-    using store_type = multi_buffer;
+    using this_class = basic_multi_storage<Allocator, StatsPolicy>;
+    using alloc_base = boost::empty_value<Allocator>;
+
+    // shared by every instantiation, so that chunks can pass between storages
+    using chunk = detail::multi_storage_chunk;
+
+    // allocation sizes, including the chunk header
+    static constexpr std::size_t min_chunk_allocation = 1024;
+    static constexpr std::size_t max_chunk_allocation = 64 * 1024;
+
+    using chunk_alloc_type = typename std::allocator_traits<Allocator>::template rebind_alloc<chunk>;
+    using chunk_alloc_traits = std::allocator_traits<chunk_alloc_type>;
+
+public:
+
+    using allocator_type = Allocator;
+
+    /// grow() never moves the readable bytes
+    static constexpr bool stable_growth = true;
+
+    /// Lazy buffer sequence over a window of the chunk list
+    template<class BufferType>
+    class buffers_window
+    {
+    public:
+
+        using value_type = BufferType;
+
+        class const_iterator
+        {
+            friend buffers_window;
+
+            buffers_window const *window_ = nullptr;
+            chunk *chunk_ = nullptr;      // nullptr at the end of the window
+
+            const_iterator(
+                buffers_window const &window,
+                chunk *c)
+                : window_(std::addressof(window))
+                , chunk_(c)
+            {}
+
+        public:
+            using value_type = BufferType;
+            using pointer = value_type const *;
+            using reference = value_type;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            const_iterator() = default;
+
+            bool
+            operator==(const_iterator const &other) const
+            {
+                return chunk_ == other.chunk_;
+            }
+
+            bool
+            operator!=(const_iterator const &other) const
+            {
+                return !(*this == other);
+            }
+
+            reference
+            operator*() const
+            {
+                return value_type(chunk_->bytes() + window_->start(chunk_), window_->length(chunk_));
+            }
+
+            pointer
+            operator->() const = delete;
+
+            const_iterator &
+            operator++()
+            {
+                chunk_ = chunk_ == window_->last_ ? nullptr : chunk_->next;
+                return *this;
+            }
+
+            const_iterator
+            operator++(int)
+            {
+                auto temp = *this;
+                ++(*this);
+                return temp;
+            }
+
+            const_iterator &
+            operator--()
+            {
+                chunk_ = chunk_ ? chunk_->prev : window_->last_;
+                return *this;
+            }
+
+            const_iterator
+            operator--(int)
+            {
+                auto temp = *this;
+                --(*this);
+                return temp;
+            }
+        };
+
+        const_iterator
+        begin() const
+        {
+            return const_iterator(*this, first_);
+        }
+
+        const_iterator
+        end() const
+        {
+            return const_iterator(*this, nullptr);
+        }
+
+    private:
 
-    using mutable_buffers_type = store_type::mutable_buffers_type;
-    using const_buffers_type = store_type::const_buffers_type;
-    using mutable_data_type = store_type::mutable_data_type;
+        friend basic_multi_storage;
+
+        buffers_window(
+            chunk *first,
+            std::size_t first_offset,
+            chunk *last,
+            std::size_t last_end)
+            : first_(first)
+            , first_offset_(first_offset)
+            , last_(last)
+            , last_end_(last_end)
+        {}
+
+        std::size_t
+        start(chunk *c) const
+        {
+            return c == first_ ? first_offset_ : 0;
+        }
+
+        std::size_t
+        length(chunk *c) const
+        {
+            return (c == last_ ? last_end_ : c->used) - start(c);
+        }
+
+        chunk *first_;
+        std::size_t first_offset_;
+        chunk *last_;
+        std::size_t last_end_;      // end offset of the window in last_
+    };
+
+private:
+    // internal dynamic buffer interface
+    using mutable_buffers_type = buffers_window<net::mutable_buffer>;
+    using const_buffers_type = buffers_window<net::const_buffer>;
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    std::size_t
+    max_size() const
+    {
+        return max_size_;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return capacity_ - in_pos_ + (spare_ ? spare_->capacity : 0);
+    }
+
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        return window<const_buffers_type>(pos, n);
+    }
 
     mutable_buffers_type
-    prepare(std::size_t n)
+    data(std::size_t pos, std::size_t n)
     {
-        auto result = store_.prepare(n);
-        prepared_ += n;
-        return result;
+        return window<mutable_buffers_type>(pos, n);
     }
 
     void
-    consume(std::size_t n)
+    grow(std::size_t n)
     {
-        return store_.consume(n);
+        if (max_size_ - size_ < n)
+            boost::throw_exception(std::length_error("grow"));
+
+        size_ += n;
+        while (n)
+        {
+            if (!tail_ || tail_->used == tail_->capacity)
+                push_back(n);
+
+            auto take = std::min(n, tail_->capacity - tail_->used);
+            tail_->used += take;
+            n -= take;
+        }
+        this->stats_policy().on_resize(size_, capacity());
     }
 
     void
-    dispose_input(std::size_t n)
+    shrink(std::size_t n)
     {
-        n = std::min(prepared_, n);
-        if (prepared_)
+        n = std::min(n, size_);
+        size_ -= n;
+        while (n)
         {
-            store_.commit(prepared_ - n);
+            auto in_tail = tail_->used - (tail_ == head_ ? in_pos_ : 0);
+            auto take = std::min(n, in_tail);
+            tail_->used -= take;
+            n -= take;
+            if (take == in_tail && tail_ != head_)
+                pop_back();
         }
-        prepared_ = 0;
+        if (size_ == 0)
+            reset_head();
     }
 
-    const_buffers_type
-    data() const
+    void
+    consume(std::size_t n)
     {
-        return store_.data();
+        n = std::min(n, size_);
+        size_ -= n;
+        while (n)
+        {
+            auto in_head = head_->used - in_pos_;
+            if (n < in_head)
+            {
+                in_pos_ += n;
+                break;
+            }
+            n -= in_head;
+            if (head_ == tail_)
+                break;
+            pop_front();
+        }
+        if (size_ == 0)
+            reset_head();
     }
 
-    mutable_data_type
-    data()
+    friend beast_v2_dynamic_buffer_model<this_class>;
+
+    template<class, class>
+    friend class basic_multi_storage;
+
+public:
+    allocator_type
+    get_allocator() const
     {
-        auto result = store_.data();
-        return result;
+        return alloc_base::get();
     }
 
+    /// Move the first n readable bytes of source, or all of them if it holds fewer, to the end of this
+    /// storage, and return how many were moved.
+    ///
+    /// Chunks holding only bytes being moved change owner without their bytes being copied. Only the
+    /// bytes at the edges, in a partly consumed first chunk or a partly moved last chunk, are copied.
+    /// When the allocators differ every byte is copied. Throws std::length_error if the bytes would
+    /// exceed max_size().
+    template<class OtherStatsPolicy>
     std::size_t
-    max_size() const
+    splice(
+        basic_multi_storage<Allocator, OtherStatsPolicy> &source,
+        std::size_t n)
     {
-        return store_.max_size();
+        n = std::min(n, source.size_);
+        if (n == 0 || static_cast<void const *>(&source) == this)
+            return 0;
+        if (max_size_ - size_ < n)
+            boost::throw_exception(std::length_error("splice"));
+
+        auto remaining = n;
+        if (!(get_allocator() == source.get_allocator()))
+        {
+            append_from(source, remaining);
+            return n;
+        }
+
+        if (source.in_pos_)
+        {
+            auto take = std::min(remaining, source.head_->used - source.in_pos_);
+            append_from(source, take);
+            remaining -= take;
+        }
+
+        while (remaining && source.head_->used <= remaining)
+        {
+            auto c = source.head_;
+            source.head_ = source.head_->next;
+            if (source.head_)
+                source.head_->prev = nullptr;
+            else
+                source.tail_ = nullptr;
+            source.capacity_ -= c->capacity;
+            source.size_ -= c->used;
+            remaining -= c->used;
+            adopt(c);
+        }
+
+        if (remaining)
+            append_from(source, remaining);
+
+        if (source.size_ == 0)
+            source.reset_head();
+        this->stats_policy().on_resize(size_, capacity());
+        return n;
     }
 
+// constructors
 public:
 
-    multi_storage()
-        : store_()
+    basic_multi_storage()
+        : basic_multi_storage(std::numeric_limits<std::size_t>::max())
+    {}
+
+    explicit
+    basic_multi_storage(Allocator const &alloc)
+        : basic_multi_storage(std::numeric_limits<std::size_t>::max(), alloc)
     {}
 
-    multi_storage(std::size_t limit)
-        : store_(limit)
+    basic_multi_storage(
+        std::size_t limit,
+        Allocator const &alloc = Allocator())
+        : alloc_base(boost::empty_init_t(), alloc)
+        , max_size_(limit)
     {}
 
+    basic_multi_storage(basic_multi_storage &&other) noexcept
+        : alloc_base(boost::empty_init_t(), std::move(other.alloc_base::get()))
+        , detail::with_storage_stats<StatsPolicy>(other.stats())
+        , head_(other.head_)
+        , tail_(other.tail_)
+        , spare_(other.spare_)
+        , in_pos_(other.in_pos_)
+        , size_(other.size_)
+        , capacity_(other.capacity_)
+        , max_size_(other.max_size_)
+    {
+        other.head_ = nullptr;
+        other.tail_ = nullptr;
+        other.spare_ = nullptr;
+        other.in_pos_ = 0;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    basic_multi_storage(basic_multi_storage const &) = delete;
+
+    basic_multi_storage &
+    operator=(basic_multi_storage const &) = delete;
+
+    ~basic_multi_storage()
+    {
+        while (head_)
+        {
+            auto next = head_->next;
+            deallocate(head_);
+            head_ = next;
+        }
+        if (spare_)
+            deallocate(spare_);
+    }
+
 private:
-    store_type store_;
-    std::size_t prepared_ = 0;
-};
 
-struct multi_storage_dynamic_buffer
-{
-    using storage_type = multi_storage;
+    // locate the byte at offset pos from the first readable byte, searching from whichever end of
+    // the list is nearer. pos must be less than size_.
+    void
+    locate(
+        std::size_t pos,
+        chunk *&c,
+        std::size_t &offset) const
+    {
+        if (pos < size_ / 2)
+        {
+            c = head_;
+            offset = in_pos_ + pos;
+            while (offset >= c->used)
+            {
+                offset -= c->used;
+                c = c->next;
+            }
+        }
+        else
+        {
+            c = tail_;
+            auto from_end = size_ - pos;  // bytes from pos to the end, at least 1
+            while (from_end > c->used - (c == head_ ? in_pos_ : 0))
+            {
+                from_end -= c->used - (c == head_ ? in_pos_ : 0);
+                c = c->prev;
+            }
+            offset = c->used - from_end;
+        }
+    }
+
+    template<class Window>
+    Window
+    window(std::size_t pos, std::size_t n) const
+    {
+        BOOST_ASSERT(pos < size_ || n == 0);
+        BOOST_ASSERT(n + pos <= size_);
+        if (n == 0)
+            return Window(nullptr, 0, nullptr, 0);
 
-    using mutable_buffers_type = typename storage_type::mutable_buffers_type;
-    using const_buffers_type = typename storage_type::const_buffers_type;
-    using mutable_data_type = storage_type::mutable_data_type;
+        chunk *first, *last;
+        std::size_t first_offset, last_offset;
+        locate(pos, first, first_offset);
+        locate(pos + n - 1, last, last_offset);
+        return Window(first, first_offset, last, last_offset + 1);
+    }
+
+    static
+    std::size_t
+    allocation_for(std::size_t n)
+    {
+        auto wanted = n + sizeof(chunk);
+        auto result = min_chunk_allocation;
+        while (result < wanted && result < max_chunk_allocation)
+            result *= 2;
+        return result;
+    }
 
-    auto
-    prepare(std::size_t n) -> mutable_buffers_type
+    // allocations are multiples of the header size, so that the allocator can supply them as chunks
+    chunk *
+    allocate(std::size_t allocation)
     {
-        return storage_->prepare(n);
+        auto alloc = chunk_alloc_type(alloc_base::get());
+        auto c = chunk_alloc_traits::allocate(alloc, allocation / sizeof(chunk));
+        this->stats_policy().on_allocate(allocation);
+        c->prev = nullptr;
+        c->next = nullptr;
+        c->capacity = allocation - sizeof(chunk);
+        c->used = 0;
+        return c;
     }
 
     void
-    dispose_input(std::size_t n)
+    deallocate(chunk *c)
     {
-        return storage_->dispose_input(n);
+        auto alloc = chunk_alloc_type(alloc_base::get());
+        chunk_alloc_traits::deallocate(alloc, c, (c->capacity + sizeof(chunk)) / sizeof(chunk));
     }
 
-    mutable_data_type
-    data() const
+    // append an empty chunk, sized for n more bytes
+    void
+    push_back(std::size_t n)
     {
-        return storage_->data();
+        auto allocation = allocation_for(n);
+        chunk *c;
+        if (spare_ && spare_->capacity + sizeof(chunk) >= allocation)
+        {
+            c = spare_;
+            spare_ = nullptr;
+        }
+        else
+            c = allocate(allocation);
+
+        c->used = 0;
+        c->next = nullptr;
+        c->prev = tail_;
+        if (tail_)
+            tail_->next = c;
+        else
+            head_ = c;
+        tail_ = c;
+        capacity_ += c->capacity;
     }
 
     void
-    consume(std::size_t n)
+    release(chunk *c)
     {
-        return storage_->consume(n);
+        capacity_ -= c->capacity;
+        if (!spare_)
+            spare_ = c;
+        else if (spare_->capacity < c->capacity)
+        {
+            deallocate(spare_);
+            spare_ = c;
+        }
+        else
+            deallocate(c);
     }
 
-    std::size_t
-    size() const
+    void
+    pop_back()
     {
-        return net::buffer_size(storage_->data());
+        auto c = tail_;
+        tail_ = c->prev;
+        tail_->next = nullptr;
+        release(c);
     }
 
-    std::size_t
-    max_size() const
+    void
+    pop_front()
     {
-        return storage_->max_size();
+        auto c = head_;
+        head_ = c->next;
+        head_->prev = nullptr;
+        in_pos_ = 0;
+        release(c);
     }
 
-public:
+    // append a copy of the first n readable bytes of source, and consume them from it
+    template<class OtherStorage>
+    void
+    append_from(
+        OtherStorage &source,
+        std::size_t n)
+    {
+        auto pos = size_;
+        grow(n);
+        net::buffer_copy(data(pos, n), source.data(0, n));
+        source.consume(n);
+        this->stats_policy().on_move(n);
+    }
 
-    multi_storage_dynamic_buffer(storage_type &storage)
-    : storage_(std::addressof(storage))
-    {}
+    // link a chunk taken whole from another storage after the last one
+    void
+    adopt(chunk *c)
+    {
+        // an empty storage's remaining chunk has nothing to keep
+        if (size_ == 0 && head_)
+        {
+            auto empty = head_;
+            head_ = tail_ = nullptr;
+            in_pos_ = 0;
+            release(empty);
+        }
 
-private:
+        c->next = nullptr;
+        c->prev = tail_;
+        if (tail_)
+            tail_->next = c;
+        else
+            head_ = c;
+        tail_ = c;
+        capacity_ += c->capacity;
+        size_ += c->used;
+    }
 
-    storage_type *storage_;
+    // the storage is empty: reuse the remaining chunk from its start
+    void
+    reset_head()
+    {
+        in_pos_ = 0;
+        if (head_)
+            head_->used = 0;
+    }
+
+    chunk *head_ = nullptr;
+    chunk *tail_ = nullptr;
+    chunk *spare_ = nullptr;
+    std::size_t in_pos_ = 0;        // offset of the first readable byte in head_
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;      // total capacity of the chunks in the list
+    std::size_t max_size_;
 };
 
-template<>
-struct is_beast_v2_dynamic_buffer<multi_storage_dynamic_buffer, void>
-    : std::true_type
+using multi_storage = basic_multi_storage<>;
+
+#if BOOST_BEAST_HAS_STD_PMR
+namespace pmr {
+using multi_storage = basic_multi_storage<std::pmr::polymorphic_allocator<char>>;
+}
+#endif
+
+template<class Allocator, class StatsPolicy = no_storage_stats>
+struct basic_multi_storage_dynamic_buffer
+    : beast_v2_dynamic_buffer_model<basic_multi_storage<Allocator, StatsPolicy>>
 {
+    using base_class = beast_v2_dynamic_buffer_model<basic_multi_storage<Allocator, StatsPolicy>>;
+
+    using base_class::base_class;
 };
 
+using multi_storage_dynamic_buffer = basic_multi_storage_dynamic_buffer<std::allocator<char>>;
 
-inline auto
-dynamic_buffer(multi_storage &storage)
--> multi_storage_dynamic_buffer
+template<class Allocator, class StatsPolicy>
+auto
+dynamic_buffer(basic_multi_storage<Allocator, StatsPolicy> &storage)
+-> basic_multi_storage_dynamic_buffer<Allocator, StatsPolicy>
 {
     return {storage};
 }
 
 }
-}
\ No newline at end of file
+}
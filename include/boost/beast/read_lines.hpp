@@ -0,0 +1,308 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/async_base.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/beast/core/string.hpp>
+#include <boost/beast/core/detail/type_traits.hpp>
+#include <boost/beast/adaptive_read_size.hpp>
+#include <boost/beast/delimiter_search.hpp>
+#include <boost/beast/read_until.hpp>
+#include <boost/beast/storage_traits.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace boost {
+namespace beast {
+
+/// A line in the readable bytes of a dynamic buffer: its offset and its size, excluding the delimiter
+/// which follows it
+struct line_span
+{
+    std::size_t offset;
+    std::size_t size;
+};
+
+/// The complete lines found by async_read_lines.
+///
+/// Lines are offsets into the dynamic buffer the read was made with, and remain valid until its
+/// readable bytes are consumed. Once the batch is processed, consume bytes() from the buffer to
+/// release every line at once. Keep a batch across reads to reuse its memory.
+class line_batch
+{
+public:
+
+    using const_iterator = std::vector<line_span>::const_iterator;
+
+    /// The number of lines
+    std::size_t
+    size() const
+    {
+        return lines_.size();
+    }
+
+    bool
+    empty() const
+    {
+        return lines_.empty();
+    }
+
+    line_span const &
+    operator[](std::size_t i) const
+    {
+        return lines_[i];
+    }
+
+    const_iterator
+    begin() const
+    {
+        return lines_.begin();
+    }
+
+    const_iterator
+    end() const
+    {
+        return lines_.end();
+    }
+
+    /// The number of bytes spanned by the lines and their delimiters
+    std::size_t
+    bytes() const
+    {
+        return bytes_;
+    }
+
+    void
+    clear()
+    {
+        lines_.clear();
+        bytes_ = 0;
+    }
+
+    /// Append the line ending `end_of_line` bytes after the previous one, delimiter included
+    void
+    push_back(
+        std::size_t end_of_line,
+        std::size_t delimiter_size)
+    {
+        BOOST_ASSERT(end_of_line >= delimiter_size);
+        lines_.push_back(line_span{bytes_, end_of_line - delimiter_size});
+        bytes_ += end_of_line;
+    }
+
+private:
+
+    std::vector<line_span> lines_;
+    std::size_t bytes_ = 0;
+};
+
+/// The bytes of a line in a contiguous dynamic buffer
+template<class DynamicBuffer>
+string_view
+line_string(
+    DynamicBuffer const &buffer,
+    line_span line)
+{
+    static_assert(is_contiguous_storage<DynamicBuffer>::value,
+                  "line_string requires a contiguous dynamic buffer; use data(line.offset, line.size)");
+    auto bytes = net::const_buffer(buffer.data(line.offset, line.size));
+    return string_view(static_cast<char const *>(bytes.data()), bytes.size());
+}
+
+namespace detail {
+
+// Reads until at least one line is buffered, then collects every complete line in a single pass
+template<class Stream,
+    class BeastV2DynamicBuffer,
+    class Handler>
+struct read_lines_op
+    : async_base<Handler, boost::beast::executor_type<Stream>>
+{
+    read_lines_op(
+        Stream &stream,
+        BeastV2DynamicBuffer dyn_buf,
+        string_view delimiter,
+        line_batch &lines,
+        adaptive_read_size *sizing,
+        Handler handler)
+        : async_base<Handler,
+        boost::beast::executor_type<Stream>>(
+        std::move(handler),
+        stream.get_executor())
+        , dyn_buf_(dyn_buf)
+        , search_(delimiter)
+        , delimiter_size_(delimiter.size())
+        , lines_(lines)
+    {
+        lines_.clear();
+        if (sizing)
+            boost::beast::async_read_until(stream, dyn_buf, delimiter, *sizing, std::move(*this));
+        else
+            boost::beast::async_read_until(stream, dyn_buf, delimiter, std::move(*this));
+    }
+
+    // async_read_until has already posted the completion if it did not read
+    void
+    operator()(
+        boost::beast::error_code ec,
+        std::size_t end_of_line)
+    {
+        if (!ec)
+        {
+            auto size = dyn_buf_.size();
+            do
+            {
+                lines_.push_back(end_of_line, delimiter_size_);
+                end_of_line = find_delimiter(lines_.bytes(), size);
+            }
+            while (end_of_line);
+        }
+        this->complete_now(ec, lines_.bytes());
+    }
+
+private:
+    // the offset, from pos, one past the next delimiter, or 0
+    std::size_t
+    find_delimiter(std::size_t pos, std::size_t size)
+    {
+        if (pos == size)
+            return 0;
+
+        search_.reset();
+        return find_delimiter(pos, size, is_contiguous_storage<BeastV2DynamicBuffer>());
+    }
+
+    std::size_t
+    find_delimiter(std::size_t pos, std::size_t size, std::false_type)
+    {
+        return search_.search(dyn_buf_.data(pos, size - pos));
+    }
+
+    std::size_t
+    find_delimiter(std::size_t pos, std::size_t size, std::true_type)
+    {
+        auto buffer = net::const_buffer(dyn_buf_.data(pos, size - pos));
+        return search_.search_contiguous(static_cast<char const *>(buffer.data()), size - pos);
+    }
+
+    BeastV2DynamicBuffer dyn_buf_;
+    delimiter_search search_;
+    std::size_t delimiter_size_;
+    line_batch &lines_;
+};
+
+struct run_read_lines_op
+{
+    template<
+        class ReadHandler,
+        class AsyncReadStream,
+        class DynamicBuffer>
+    void
+    operator()(
+        ReadHandler &&h,
+        AsyncReadStream *s,
+        DynamicBuffer b,
+        string_view delimiter,
+        line_batch *lines,
+        adaptive_read_size *sizing)
+    {
+        using namespace boost::beast;
+
+        // If you get an error on the following line it means
+        // that your handler does not meet the documented type
+        // requirements for the handler.
+
+        static_assert(
+            detail::is_invocable<ReadHandler,
+                void(
+                    error_code,
+                    std::size_t)>::value,
+            "ReadHandler type requirements not met");
+
+        read_lines_op<
+            AsyncReadStream,
+            DynamicBuffer,
+            typename std::decay<ReadHandler>::type>(*s, b, delimiter, *lines, sizing,
+                                                    std::forward<ReadHandler>(h));
+    }
+
+};
+
+}
+
+/// Read into the dynamic buffer until it holds at least one complete line, then complete once with
+/// every complete line it holds.
+///
+/// The lines are stored in `lines`, which must remain valid until the handler is invoked. The handler
+/// receives lines.bytes(), which is 0 on error. The lines are not consumed: consume them together
+/// once they are processed.
+template<
+    class AsyncReadStream,
+    class DynamicBuffer,
+    class ReadHandler>
+BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+async_read_lines(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    string_view delimiter,
+    line_batch &lines,
+    ReadHandler &&handler)
+{
+    static_assert(is_async_read_stream<AsyncReadStream>::value,
+                  "AsyncReadStream type requirements not met");
+    static_assert(
+        net::is_dynamic_buffer_v2<DynamicBuffer>::value,
+        "DynamicBuffer type requirements not met");
+    return net::async_initiate<
+        ReadHandler,
+        void(
+            error_code,
+            std::size_t)>(
+        detail::run_read_lines_op(),
+        handler,
+        &stream,
+        buffer,
+        delimiter,
+        &lines,
+        nullptr);
+}
+
+/// Read lines as above, sizing reads with and updating sizing, which must remain valid until the
+/// handler is invoked
+template<
+    class AsyncReadStream,
+    class DynamicBuffer,
+    class ReadHandler>
+BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+async_read_lines(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    string_view delimiter,
+    line_batch &lines,
+    adaptive_read_size &sizing,
+    ReadHandler &&handler)
+{
+    static_assert(is_async_read_stream<AsyncReadStream>::value,
+                  "AsyncReadStream type requirements not met");
+    static_assert(
+        net::is_dynamic_buffer_v2<DynamicBuffer>::value,
+        "DynamicBuffer type requirements not met");
+    return net::async_initiate<
+        ReadHandler,
+        void(
+            error_code,
+            std::size_t)>(
+        detail::run_read_lines_op(),
+        handler,
+        &stream,
+        buffer,
+        delimiter,
+        &lines,
+        &sizing);
+}
+
+}
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/async_base.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/beast/core/string.hpp>
+#include <boost/beast/core/detail/type_traits.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/adaptive_read_size.hpp>
+#include <boost/beast/delimiter_search.hpp>
+#include <boost/beast/storage_traits.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <algorithm>
+
+namespace boost {
+namespace beast {
+namespace detail {
+
+template<class Stream,
+    class BeastV2DynamicBuffer,
+    class Handler>
+struct read_until_op
+    : boost::asio::coroutine
+      , async_base<Handler, boost::beast::executor_type<Stream>>
+{
+    // sizing, if not null, seeds the read size and receives what was learned on completion
+    read_until_op(
+        Stream &stream,
+        BeastV2DynamicBuffer dyn_buf,
+        string_view delimiter,
+        adaptive_read_size *sizing,
+        Handler handler)
+        : async_base<Handler,
+        boost::beast::executor_type<Stream>>(
+        std::move(handler),
+        stream.get_executor())
+        , stream_(stream)
+        , dyn_buf_(dyn_buf)
+        , search_(delimiter)
+        , sizing_(sizing ? *sizing : adaptive_read_size())
+        , shared_sizing_(sizing)
+    {
+        (*this)(error_code(), 0);
+    }
+
+#include <boost/asio/yield.hpp>
+
+    void
+    operator()(
+        boost::beast::error_code ec,
+        std::size_t bytes_transferred)
+    {
+        reenter(this)
+        for (;;)
+        {
+            end_of_sequence_ = find_delimiter();
+            if (end_of_sequence_)
+                goto completion;
+
+            to_read_ = sizing_.next(dyn_buf_.max_size() - dyn_buf_.size());
+
+            if (to_read_ == 0)
+            {
+                ec = http::error::body_limit;
+                goto completion;
+            }
+
+            is_continuation_ = true;
+
+            // note: this is safe. dynamic_buffers are lightweight references to storage which do not
+            // lose state when moved from
+
+            yield
+            {
+                auto pos = dyn_buf_.size();
+                dyn_buf_.grow(to_read_);
+                auto buffers = dyn_buf_.data(pos, to_read_);
+                auto &stream = stream_;
+                stream.async_read_some(buffers, std::move(*this));
+            }
+
+            dyn_buf_.shrink(to_read_ - bytes_transferred);
+            sizing_.update(to_read_, bytes_transferred);
+
+            if (ec)
+                goto completion;
+        }
+
+        return;
+
+        completion:
+
+        if (shared_sizing_)
+            *shared_sizing_ = sizing_;
+        this->complete(is_continuation_, ec, end_of_sequence_);
+    }
+
+#include <boost/asio/unyield.hpp>
+
+private:
+    // Searches only the bytes which arrived since the previous call
+    std::size_t
+    find_delimiter()
+    {
+        auto size = dyn_buf_.size();
+        if (search_.searched() == size)
+            return 0;
+
+        return find_delimiter(size, is_contiguous_storage<BeastV2DynamicBuffer>());
+    }
+
+    std::size_t
+    find_delimiter(std::size_t size, std::false_type)
+    {
+        return search_.search(dyn_buf_.data(search_.searched(), size - search_.searched()));
+    }
+
+    // one pointer and length: search in place, without retaining bytes between reads
+    std::size_t
+    find_delimiter(std::size_t size, std::true_type)
+    {
+        auto buffer = net::const_buffer(dyn_buf_.data(0, size));
+        return search_.search_contiguous(static_cast<char const *>(buffer.data()), size);
+    }
+
+    Stream &stream_;
+    BeastV2DynamicBuffer dyn_buf_;
+    std::size_t to_read_ = 0;
+    delimiter_search search_;
+    adaptive_read_size sizing_;
+    adaptive_read_size *shared_sizing_;
+    std::size_t end_of_sequence_ = 0;
+    bool is_continuation_ = false;
+};
+
+struct run_read_until_op
+{
+    template<
+        class ReadHandler,
+        class AsyncReadStream,
+        class DynamicBuffer>
+    void
+    operator()(
+        ReadHandler &&h,
+        AsyncReadStream *s,
+        DynamicBuffer b,
+        string_view delimiter,
+        adaptive_read_size *sizing)
+    {
+        using namespace boost::beast;
+
+        // If you get an error on the following line it means
+        // that your handler does not meet the documented type
+        // requirements for the handler.
+
+        static_assert(
+            detail::is_invocable<ReadHandler,
+                void(
+                    error_code,
+                    std::size_t)>::value,
+            "ReadHandler type requirements not met");
+
+        read_until_op<
+            AsyncReadStream,
+            DynamicBuffer,
+            typename std::decay<ReadHandler>::type>(*s, b, delimiter, sizing,
+                                                    std::forward<ReadHandler>(h));
+    }
+
+};
+
+}
+
+/// Read into the dynamic buffer until it contains the delimiter. Replaces net::async_read_until for
+/// v2 dynamic buffers, searching with delimiter_search instead of linearising the data.
+template<
+    class AsyncReadStream,
+    class DynamicBuffer,
+    class ReadHandler>
+BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+async_read_until(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    string_view delimiter,
+    ReadHandler &&handler)
+{
+    static_assert(is_async_read_stream<AsyncReadStream>::value,
+                  "AsyncReadStream type requirements not met");
+    static_assert(
+        net::is_dynamic_buffer_v2<DynamicBuffer>::value,
+        "DynamicBuffer type requirements not met");
+    return net::async_initiate<
+        ReadHandler,
+        void(
+            error_code,
+            std::size_t)>(
+        detail::run_read_until_op(),
+        handler,
+        &stream,
+        buffer,
+        delimiter,
+        nullptr);
+}
+
+/// Read into the dynamic buffer until it contains the delimiter, sizing reads with and updating sizing,
+/// which must remain valid until the handler is invoked.
+template<
+    class AsyncReadStream,
+    class DynamicBuffer,
+    class ReadHandler>
+BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+async_read_until(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    string_view delimiter,
+    adaptive_read_size &sizing,
+    ReadHandler &&handler)
+{
+    static_assert(is_async_read_stream<AsyncReadStream>::value,
+                  "AsyncReadStream type requirements not met");
+    static_assert(
+        net::is_dynamic_buffer_v2<DynamicBuffer>::value,
+        "DynamicBuffer type requirements not met");
+    return net::async_initiate<
+        ReadHandler,
+        void(
+            error_code,
+            std::size_t)>(
+        detail::run_read_until_op(),
+        handler,
+        &stream,
+        buffer,
+        delimiter,
+        &sizing);
+}
+
+template<
+    class AsyncReadStream,
+    class DynamicBuffer,
+    class ReadHandler>
+BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+async_read_until_crlf(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    ReadHandler &&handler)
+{
+    return boost::beast::async_read_until(stream, buffer, "\r\n", std::forward<ReadHandler>(handler));
+}
+
+template<
+    class AsyncReadStream,
+    class DynamicBuffer,
+    class ReadHandler>
+BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+async_read_until_crlf(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    adaptive_read_size &sizing,
+    ReadHandler &&handler)
+{
+    return boost::beast::async_read_until(stream, buffer, "\r\n", sizing, std::forward<ReadHandler>(handler));
+}
+
+}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/string.hpp>
+#include <boost/beast/handler_memory.hpp>
+#include <boost/beast/read_until.hpp>
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT) && defined(BOOST_ASIO_HAS_STD_COROUTINE)
+#define BOOST_BEAST_HAS_CO_AWAIT 1
+#include <coroutine>
+#endif
+
+#if BOOST_BEAST_HAS_CO_AWAIT
+
+namespace boost {
+namespace beast {
+namespace detail {
+
+// Resumes the awaiting coroutine. Its associated allocator gives the operation's state the
+// connection's handler_memory.
+struct read_until_resume_handler
+{
+    using allocator_type = handler_memory_allocator<char>;
+
+    std::coroutine_handle<> coroutine;
+    error_code *ec;
+    std::size_t *bytes_transferred;
+    handler_memory *memory;
+
+    allocator_type
+    get_allocator() const noexcept
+    {
+        return allocator_type(*memory);
+    }
+
+    void
+    operator()(
+        error_code result_ec,
+        std::size_t result_bytes_transferred)
+    {
+        *ec = result_ec;
+        *bytes_transferred = result_bytes_transferred;
+        coroutine.resume();
+    }
+};
+
+}
+
+/// The awaitable form of async_read_until, for coroutine types which accept any awaitable.
+///
+/// The awaitable lives in the awaiting coroutine's frame, so awaiting it allocates nothing itself, and
+/// the state of the read goes into the connection's handler_memory. A loop reading lines thus reaches a
+/// steady state without allocation. co_await yields the offset one past the delimiter, or throws
+/// system_error. The coroutine is resumed on the stream's executor.
+///
+/// Inside net::awaitable coroutines, which accept only net::awaitable, await
+/// async_read_until_crlf(stream, buffer, net::use_awaitable) instead: Asio recycles those frames
+/// through its per-thread cache.
+template<
+    class AsyncReadStream,
+    class DynamicBuffer>
+class read_until_awaitable
+{
+public:
+
+    read_until_awaitable(
+        AsyncReadStream &stream,
+        DynamicBuffer buffer,
+        string_view delimiter,
+        handler_memory &memory)
+        : stream_(stream)
+        , buffer_(buffer)
+        , delimiter_(delimiter)
+        , memory_(memory)
+    {}
+
+    bool
+    await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void
+    await_suspend(std::coroutine_handle<> coroutine)
+    {
+        boost::beast::async_read_until(
+            stream_, buffer_, delimiter_,
+            detail::read_until_resume_handler{coroutine, &ec_, &bytes_transferred_, &memory_});
+    }
+
+    std::size_t
+    await_resume()
+    {
+        if (ec_)
+            throw system_error(ec_);
+        return bytes_transferred_;
+    }
+
+private:
+
+    AsyncReadStream &stream_;
+    DynamicBuffer buffer_;
+    string_view delimiter_;
+    handler_memory &memory_;
+    error_code ec_;
+    std::size_t bytes_transferred_ = 0;
+};
+
+/// Await reading into the dynamic buffer until it contains the delimiter, which must remain valid until
+/// the read starts
+template<
+    class AsyncReadStream,
+    class DynamicBuffer>
+read_until_awaitable<AsyncReadStream, DynamicBuffer>
+co_read_until(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    string_view delimiter,
+    handler_memory &memory)
+{
+    static_assert(is_async_read_stream<AsyncReadStream>::value,
+                  "AsyncReadStream type requirements not met");
+    static_assert(
+        net::is_dynamic_buffer_v2<DynamicBuffer>::value,
+        "DynamicBuffer type requirements not met");
+    return {stream, buffer, delimiter, memory};
+}
+
+template<
+    class AsyncReadStream,
+    class DynamicBuffer>
+read_until_awaitable<AsyncReadStream, DynamicBuffer>
+co_read_until_crlf(
+    AsyncReadStream &stream,
+    DynamicBuffer buffer,
+    handler_memory &memory)
+{
+    return boost::beast::co_read_until(stream, buffer, "\r\n", memory);
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/asio/buffer.hpp>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace boost {
+namespace beast {
+
+/// The most buffers a single readv/writev accepts
+#if defined(IOV_MAX)
+constexpr std::size_t max_iov_buffers = IOV_MAX;
+#else
+constexpr std::size_t max_iov_buffers = 1024;
+#endif
+
+/// A buffer sequence holding up to N buffers inline, and spilling to the heap beyond that.
+///
+/// The general form of basic_upto2_buffers, for sequences of a few buffers which must be materialised,
+/// such as a gather write collected from several sources. Empty buffers are not stored, and no more
+/// than max_iov_buffers are, so that the whole sequence can be passed to one readv/writev.
+template<class BufferType, std::size_t N>
+class basic_small_buffers
+{
+public:
+
+    static_assert(N > 0, "basic_small_buffers must hold at least one buffer inline");
+
+    using value_type = BufferType;
+    using const_iterator = BufferType const *;
+    using iterator = const_iterator;
+
+    basic_small_buffers() = default;
+
+    /// Collect the buffers of a sequence, up to max_iov_buffers of them
+    template<
+        class BufferSequence,
+        class = typename std::enable_if<!std::is_same<
+            typename std::decay<BufferSequence>::type, basic_small_buffers>::value>::type>
+    explicit
+    basic_small_buffers(BufferSequence const &buffers)
+    {
+        for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it)
+            if (!push_back(BufferType(*it)))
+                break;
+    }
+
+    basic_small_buffers(basic_small_buffers const &other)
+    {
+        for (auto const &b : other)
+            push_back(b);
+    }
+
+    basic_small_buffers(basic_small_buffers &&other) noexcept
+        : inline_(other.inline_)
+        , heap_(std::move(other.heap_))
+        , size_(other.size_)
+    {
+        other.clear();
+    }
+
+    basic_small_buffers &
+    operator=(basic_small_buffers const &other)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (auto const &b : other)
+                push_back(b);
+        }
+        return *this;
+    }
+
+    /// Append b, unless it is empty. Returns false, leaving the sequence unchanged, if it is full.
+    bool
+    push_back(BufferType b)
+    {
+        if (b.size() == 0)
+            return true;
+        if (size_ == max_iov_buffers)
+            return false;
+
+        if (size_ < N)
+            inline_[size_] = b;
+        else
+        {
+            if (size_ == N)
+                heap_.assign(inline_.begin(), inline_.end());
+            heap_.push_back(b);
+        }
+        ++size_;
+        return true;
+    }
+
+    void
+    clear()
+    {
+        heap_.clear();
+        size_ = 0;
+    }
+
+    /// The number of buffers
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    bool
+    empty() const
+    {
+        return size_ == 0;
+    }
+
+    /// True if the buffers have spilled to the heap
+    bool
+    spilled() const
+    {
+        return size_ > N;
+    }
+
+    /// The total number of bytes
+    std::size_t
+    bytes() const
+    {
+        std::size_t n = 0;
+        for (auto const &b : *this)
+            n += b.size();
+        return n;
+    }
+
+    const_iterator
+    begin() const
+    {
+        return spilled() ? heap_.data() : inline_.data();
+    }
+
+    const_iterator
+    end() const
+    {
+        return begin() + size_;
+    }
+
+private:
+
+    std::array<BufferType, N> inline_;
+    std::vector<BufferType> heap_;      // every buffer, once there are more than N
+    std::size_t size_ = 0;
+};
+
+template<std::size_t N = 4>
+using mutable_small_buffers = basic_small_buffers<net::mutable_buffer, N>;
+
+template<std::size_t N = 4>
+using const_small_buffers = basic_small_buffers<net::const_buffer, N>;
+
+}
+}
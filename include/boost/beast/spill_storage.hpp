@@ -0,0 +1,215 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/flat_storage.hpp>
+#include <boost/beast/mapped_file_storage.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+
+namespace boost {
+namespace beast {
+
+/// Opaque storage type for resizable buffer storage which spills to a temporary file past a memory
+/// threshold
+///
+/// While the readable bytes fit within the memory threshold they are held in a flat_storage. A grow()
+/// which would take them past it moves them into a mapped_file_storage on an unlinked temporary file
+/// instead of failing, and the storage stays there until it is emptied, when the file is closed and the
+/// storage returns to memory.
+///
+/// data() is a single buffer in either place. Once spilled, the bytes are in the page cache, and
+/// consumed pages are released as they are passed. Where the directory is on a disk backed file system,
+/// the kernel writes the page cache back and reclaims it under pressure, so the memory held for the
+/// connection is bounded by the threshold rather than by the size of the request. On a tmpfs, such as
+/// /tmp on many systems, the spilled bytes stay in memory or swap, and only the tmpfs size caps them.
+///
+/// grow() throws length_error past the limit, and system_error when the file cannot be created or the
+/// file system has no room for it.
+///
+/// Each spill is reported to the StatsPolicy as an allocation, and the bytes it copies to the file as
+/// moved (see storage_stats.hpp).
+template<class StatsPolicy = no_storage_stats>
+class basic_spill_storage
+    : public detail::with_storage_stats<StatsPolicy>
+{
+    using this_class = basic_spill_storage<StatsPolicy>;
+
+private:
+    // internal dynamic buffer interface
+    using mutable_buffers_type = net::mutable_buffer;
+    using const_buffers_type = net::const_buffer;
+
+    std::size_t
+    size() const
+    {
+        return spilled_ ? file().size() : memory().size();
+    }
+
+    std::size_t
+    max_size() const
+    {
+        return max_size_;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return spilled_ ? file().capacity() : memory().capacity();
+    }
+
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        return spilled_ ? file().data(pos, n) : memory().data(pos, n);
+    }
+
+    mutable_buffers_type
+    data(std::size_t pos, std::size_t n)
+    {
+        return spilled_ ? file().data(pos, n) : memory().data(pos, n);
+    }
+
+    void
+    grow(std::size_t n)
+    {
+        if (max_size_ - size() < n)
+            boost::throw_exception(std::length_error("out of space"));
+
+        if (!spilled_ && memory().size() + n > memory_threshold_)
+            spill();
+
+        if (spilled_)
+            file().grow(n);
+        else
+            memory().grow(n);
+        this->stats_policy().on_resize(size(), capacity());
+    }
+
+    void
+    shrink(std::size_t n)
+    {
+        if (spilled_)
+            file().shrink(n);
+        else
+            memory().shrink(n);
+    }
+
+    void
+    consume(std::size_t n)
+    {
+        if (!spilled_)
+            return memory().consume(n);
+
+        file().consume(n);
+        if (file().size() == 0)
+        {
+            file_.reset();
+            spilled_ = false;
+        }
+    }
+
+    friend beast_v2_dynamic_buffer_model<this_class>;
+
+public:
+    /// Whether the readable bytes are in the file
+    bool
+    spilled() const
+    {
+        return spilled_;
+    }
+
+    /// The most bytes held in memory before the storage spills to the file
+    std::size_t
+    memory_threshold() const
+    {
+        return memory_threshold_;
+    }
+
+// constructors
+public:
+    static constexpr std::size_t default_limit = std::size_t(256) << 20;
+
+    /// A storage holding up to memory_threshold bytes in memory, and up to limit bytes in a temporary
+    /// file created in directory, which should be on a disk backed file system
+    explicit
+    basic_spill_storage(
+        std::size_t memory_threshold,
+        std::string directory = "/var/tmp",
+        std::size_t limit = default_limit)
+        : memory_(std::min(memory_threshold, limit))
+        , directory_(std::move(directory))
+        , memory_threshold_(std::min(memory_threshold, limit))
+        , max_size_(limit)
+    {}
+
+private:
+
+    beast_v2_dynamic_buffer_model<flat_storage>
+    memory() const
+    {
+        return beast_v2_dynamic_buffer_model<flat_storage>(memory_);
+    }
+
+    beast_v2_dynamic_buffer_model<mapped_file_storage>
+    file() const
+    {
+        return beast_v2_dynamic_buffer_model<mapped_file_storage>(*file_);
+    }
+
+    // move the readable bytes from memory to the file, and release the memory
+    void
+    spill()
+    {
+        file_.reset(new mapped_file_storage(mapped_file_storage::temporary(directory_.c_str(), max_size_)));
+
+        auto n = memory().size();
+        file().grow(n);
+        if (n)
+            std::memcpy(net::mutable_buffer(file().data(0, n)).data(),
+                        net::const_buffer(memory().data(0, n)).data(), n);
+        memory().consume(n);
+        memory_.shrink_to_fit();
+        this->stats_policy().on_allocate(n);
+        this->stats_policy().on_move(n);
+        spilled_ = true;
+    }
+
+    mutable flat_storage memory_;
+    std::unique_ptr<mapped_file_storage> file_;
+    std::string directory_;
+    std::size_t memory_threshold_;
+    std::size_t max_size_;
+    bool spilled_ = false;
+};
+
+using spill_storage = basic_spill_storage<>;
+
+template<class StatsPolicy = no_storage_stats>
+struct basic_spill_storage_dynamic_buffer
+    : beast_v2_dynamic_buffer_model<basic_spill_storage<StatsPolicy>>
+{
+    using base_class = beast_v2_dynamic_buffer_model<basic_spill_storage<StatsPolicy>>;
+
+    using base_class::base_class;
+};
+
+using spill_storage_dynamic_buffer = basic_spill_storage_dynamic_buffer<>;
+
+template<class StatsPolicy>
+auto
+dynamic_buffer(basic_spill_storage<StatsPolicy> &storage)
+-> basic_spill_storage_dynamic_buffer<StatsPolicy>
+{
+    return {storage};
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <boost/beast/upto2_buffers.hpp>
+
+namespace boost {
+namespace beast {
+
+/// Opaque storage type for non-extentable buffer storage in circular layout
+///
+/// Like static_storage, but the readable bytes may wrap around the end of the store, so consume()
+/// only advances an index and never moves data. Buffer sequences have at most two elements.
+template<std::size_t Capacity, class StatsPolicy = no_storage_stats>
+class static_ring_storage;
+
+template<class IntegralCapacity, class StatsPolicy = no_storage_stats>
+struct static_ring_storage_dynamic_buffer;
+
+template<std::size_t Capacity, class StatsPolicy>
+class static_ring_storage
+    : public detail::with_storage_stats<StatsPolicy>
+{
+    static_assert(Capacity > 0, "static_ring_storage must have a capacity");
+
+    std::size_t start_;     // index of the first readable byte
+    std::size_t size_;
+    char store_[Capacity];
+
+    using this_class = static_ring_storage<Capacity, StatsPolicy>;
+
+public:
+    /// grow() never moves the readable bytes
+    static constexpr bool stable_growth = true;
+
+private:
+    // internal dynamic buffer interface
+    using mutable_buffers_type = mutable_upto2_buffers;
+    using const_buffers_type = const_upto2_buffers;
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    constexpr static
+    std::size_t
+    max_size()
+    {
+        return Capacity;
+    }
+
+    constexpr static
+    std::size_t
+    capacity()
+    {
+        return Capacity;
+    }
+
+    const_buffers_type
+    data(std::size_t pos, std::size_t n) const
+    {
+        BOOST_ASSERT(pos < size() || n == 0);
+        BOOST_ASSERT(n + pos <= size());
+        auto first = index(pos);
+        auto to_end = Capacity - first;
+        if (n <= to_end)
+            return const_buffers_type(net::const_buffer(store_ + first, n));
+        return const_buffers_type(net::const_buffer(store_ + first, to_end),
+                                  net::const_buffer(store_, n - to_end));
+    }
+
+    mutable_buffers_type
+    data(std::size_t pos, std::size_t n)
+    {
+        BOOST_ASSERT(pos < size() || n == 0);
+        BOOST_ASSERT(n + pos <= size());
+        auto first = index(pos);
+        auto to_end = Capacity - first;
+        if (n <= to_end)
+            return mutable_buffers_type(net::mutable_buffer(store_ + first, n));
+        return mutable_buffers_type(net::mutable_buffer(store_ + first, to_end),
+                                    net::mutable_buffer(store_, n - to_end));
+    }
+
+    void
+    grow(std::size_t n)
+    {
+        if (max_size() - size_ < n)
+            boost::throw_exception(std::length_error("prepare"));
+
+        size_ += n;
+        this->stats_policy().on_resize(size_, Capacity);
+    }
+
+    void
+    shrink(std::size_t n)
+    {
+        size_ -= std::min(n, size_);
+    }
+
+    void
+    consume(std::size_t n)
+    {
+        n = std::min(n, size_);
+        size_ -= n;
+        // when empty, restart at the front so that the next data is contiguous
+        start_ = size_ ? index(n) : 0;
+    }
+
+    // index in store_ of the byte at offset pos from the first readable byte
+    std::size_t
+    index(std::size_t pos) const
+    {
+        auto i = start_ + pos;
+        return i >= Capacity ? i - Capacity : i;
+    }
+
+    friend beast_v2_dynamic_buffer_model<this_class>;
+
+// constructors
+public:
+    static_ring_storage()
+        : start_(0)
+        , size_(0)
+    {}
+};
+
+template<std::size_t Capacity, class StatsPolicy>
+struct static_ring_storage_dynamic_buffer<std::integral_constant<std::size_t, Capacity>, StatsPolicy>
+    : beast_v2_dynamic_buffer_model<static_ring_storage<Capacity, StatsPolicy>>
+{
+    using base_class = beast_v2_dynamic_buffer_model<static_ring_storage<Capacity, StatsPolicy>>;
+
+    using base_class::base_class;
+};
+
+template<std::size_t Capacity, class StatsPolicy>
+auto
+dynamic_buffer(static_ring_storage<Capacity, StatsPolicy> &storage)
+-> static_ring_storage_dynamic_buffer<std::integral_constant<std::size_t, Capacity>, StatsPolicy>
+{
+    return {storage};
+}
+
+
+}
+}
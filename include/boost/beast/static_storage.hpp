@@ -2,24 +2,31 @@
 
 #include <boost/beast/core/detail/config.hpp>
 #include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/storage_stats.hpp>
+#include <cstring>
 
 namespace boost {
 namespace beast {
 
 /// Opaque storage type for non-extentable buffer storage in layout of contiguous bytes
-template<std::size_t Capacity>
+template<std::size_t Capacity, class StatsPolicy = no_storage_stats>
 class static_storage;
 
-template<class IntegralCapacity>
+template<class IntegralCapacity, class StatsPolicy = no_storage_stats>
 struct static_storage_dynamic_buffer;
 
-template<std::size_t Capacity>
+template<std::size_t Capacity, class StatsPolicy>
 class static_storage
+    : public detail::with_storage_stats<StatsPolicy>
 {
     std::size_t size_;
     char store_[Capacity];
 
-    using this_class = static_storage<Capacity>;
+    using this_class = static_storage<Capacity, StatsPolicy>;
+
+public:
+    /// grow() never moves the readable bytes
+    static constexpr bool stable_growth = true;
 
 private:
     // internal dynamic buffer interface
@@ -69,6 +76,7 @@ private:
             boost::throw_exception(std::length_error("prepare"));
 
         size_ += n;
+        this->stats_policy().on_resize(size_, Capacity);
     }
 
     void
@@ -81,8 +89,12 @@ private:
     consume(std::size_t n)
     {
         n = std::min(n, size_);
-        std::memcpy(store_, store_ + n, size_ - n);
         size_ -= n;
+        if (n && size_)
+        {
+            std::memmove(store_, store_ + n, size_);
+            this->stats_policy().on_move(size_);
+        }
     }
 
     friend beast_v2_dynamic_buffer_model<this_class>;
@@ -94,22 +106,19 @@ public:
     {}
 };
 
-template<class Storage>
-struct static_storage_dynamic_buffer;
-
-template<std::size_t Capacity>
-struct static_storage_dynamic_buffer<std::integral_constant<std::size_t, Capacity>>
-    : beast_v2_dynamic_buffer_model<static_storage<Capacity>>
+template<std::size_t Capacity, class StatsPolicy>
+struct static_storage_dynamic_buffer<std::integral_constant<std::size_t, Capacity>, StatsPolicy>
+    : beast_v2_dynamic_buffer_model<static_storage<Capacity, StatsPolicy>>
 {
-    using base_class = beast_v2_dynamic_buffer_model<static_storage<Capacity>>;
+    using base_class = beast_v2_dynamic_buffer_model<static_storage<Capacity, StatsPolicy>>;
 
     using base_class::base_class;
 };
 
-template<std::size_t Capacity>
+template<std::size_t Capacity, class StatsPolicy>
 auto
-dynamic_buffer(static_storage<Capacity> &storage)
--> static_storage_dynamic_buffer<std::integral_constant<std::size_t, Capacity>>
+dynamic_buffer(static_storage<Capacity, StatsPolicy> &storage)
+-> static_storage_dynamic_buffer<std::integral_constant<std::size_t, Capacity>, StatsPolicy>
 {
     return {storage};
 }
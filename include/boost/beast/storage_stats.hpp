@@ -0,0 +1,191 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/core/empty_value.hpp>
+#include <algorithm>
+#include <cstddef>
+
+namespace boost {
+namespace beast {
+
+/// Counters describing the use of storage
+struct storage_stats
+{
+    std::size_t allocations = 0;        // allocations of new memory, other than to replace an allocation
+    std::size_t reallocations = 0;      // replacements of an allocation by a larger or smaller one
+    std::size_t bytes_moved = 0;        // bytes copied within or between allocations to keep data contiguous
+    std::size_t peak_size = 0;
+    std::size_t peak_capacity = 0;
+    std::size_t grows = 0;              // calls through the dynamic buffer interface
+    std::size_t shrinks = 0;
+    std::size_t datas = 0;
+    std::size_t consumes = 0;
+
+    /// Accumulate other. Counts are added and peaks are the greater of the two.
+    storage_stats &
+    operator+=(storage_stats const &other)
+    {
+        allocations += other.allocations;
+        reallocations += other.reallocations;
+        bytes_moved += other.bytes_moved;
+        peak_size = std::max(peak_size, other.peak_size);
+        peak_capacity = std::max(peak_capacity, other.peak_capacity);
+        grows += other.grows;
+        shrinks += other.shrinks;
+        datas += other.datas;
+        consumes += other.consumes;
+        return *this;
+    }
+};
+
+/// Stats policy which collects nothing. Every hook is empty, so instrumented code compiles to nothing.
+struct no_storage_stats
+{
+    void on_allocate(std::size_t) {}
+    void on_reallocate(std::size_t) {}
+    void on_move(std::size_t) {}
+    void on_resize(std::size_t, std::size_t) {}
+    void on_grow(std::size_t) {}
+    void on_shrink(std::size_t) {}
+    void on_data() {}
+    void on_consume(std::size_t) {}
+};
+
+/// Stats policy which counts events for each storage, and also for all storages of the calling thread.
+///
+/// The per-thread totals take the peaks of the individual storages, not of their sum.
+class counting_storage_stats
+{
+public:
+
+    /// The counters of this storage
+    storage_stats const &
+    counters() const
+    {
+        return counters_;
+    }
+
+    /// The counters of all storages using this policy on the calling thread
+    static
+    storage_stats
+    thread_snapshot()
+    {
+        return thread_counters();
+    }
+
+    static
+    void
+    reset_thread_snapshot()
+    {
+        thread_counters() = storage_stats();
+    }
+
+    void
+    on_allocate(std::size_t)
+    {
+        ++counters_.allocations;
+        ++thread_counters().allocations;
+    }
+
+    void
+    on_reallocate(std::size_t)
+    {
+        ++counters_.reallocations;
+        ++thread_counters().reallocations;
+    }
+
+    void
+    on_move(std::size_t n)
+    {
+        counters_.bytes_moved += n;
+        thread_counters().bytes_moved += n;
+    }
+
+    void
+    on_resize(std::size_t size, std::size_t capacity)
+    {
+        auto &thread = thread_counters();
+        counters_.peak_size = std::max(counters_.peak_size, size);
+        counters_.peak_capacity = std::max(counters_.peak_capacity, capacity);
+        thread.peak_size = std::max(thread.peak_size, size);
+        thread.peak_capacity = std::max(thread.peak_capacity, capacity);
+    }
+
+    void
+    on_grow(std::size_t)
+    {
+        ++counters_.grows;
+        ++thread_counters().grows;
+    }
+
+    void
+    on_shrink(std::size_t)
+    {
+        ++counters_.shrinks;
+        ++thread_counters().shrinks;
+    }
+
+    void
+    on_data()
+    {
+        ++counters_.datas;
+        ++thread_counters().datas;
+    }
+
+    void
+    on_consume(std::size_t)
+    {
+        ++counters_.consumes;
+        ++thread_counters().consumes;
+    }
+
+private:
+
+    static
+    storage_stats &
+    thread_counters()
+    {
+        static thread_local storage_stats counters;
+        return counters;
+    }
+
+    storage_stats counters_;
+};
+
+namespace detail {
+
+/// Base of the storages, holding their stats policy without overhead when it is empty
+template<class StatsPolicy>
+class with_storage_stats
+    : private boost::empty_value<StatsPolicy, 1>
+{
+    using base_type = boost::empty_value<StatsPolicy, 1>;
+
+public:
+
+    using stats_policy_type = StatsPolicy;
+
+    with_storage_stats() = default;
+
+    explicit
+    with_storage_stats(StatsPolicy const &policy)
+        : base_type(boost::empty_init_t(), policy)
+    {}
+
+    StatsPolicy const &
+    stats() const
+    {
+        return base_type::get();
+    }
+
+    StatsPolicy &
+    stats_policy()
+    {
+        return base_type::get();
+    }
+};
+
+}
+
+}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/beast/beast_v2_dynamic_buffer_model.hpp>
+#include <boost/beast/upto2_buffers.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/type_traits/make_void.hpp>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace boost {
+namespace beast {
+
+/// The value of max_segments for layouts with no fixed bound on the number of segments
+constexpr std::size_t unbounded_segments = std::numeric_limits<std::size_t>::max();
+
+/// The most buffers a value of the buffer sequence type can hold: 1, 2 or unbounded_segments
+template<class BufferSequence>
+struct buffer_sequence_max_segments
+    : std::integral_constant<std::size_t, unbounded_segments>
+{};
+
+template<>
+struct buffer_sequence_max_segments<net::const_buffer>
+    : std::integral_constant<std::size_t, 1>
+{};
+
+template<>
+struct buffer_sequence_max_segments<net::mutable_buffer>
+    : std::integral_constant<std::size_t, 1>
+{};
+
+template<class BufferType>
+struct buffer_sequence_max_segments<basic_upto2_buffers<BufferType>>
+    : std::integral_constant<std::size_t, 2>
+{};
+
+template<class BufferType, std::size_t N>
+struct buffer_sequence_max_segments<std::array<BufferType, N>>
+    : std::integral_constant<std::size_t, N>
+{};
+
+namespace detail {
+
+template<class T, class = void>
+struct has_public_const_buffers_type
+    : std::false_type
+{};
+
+template<class T>
+struct has_public_const_buffers_type<T, boost::void_t<typename T::const_buffers_type>>
+    : std::true_type
+{};
+
+// dynamic buffers publish their buffer types; storages give them only to their dynamic buffer model
+template<class T, bool = has_public_const_buffers_type<T>::value>
+struct const_buffers_type_of
+{
+    using type = typename T::const_buffers_type;
+};
+
+template<class T>
+struct const_buffers_type_of<T, false>
+{
+    using type = typename beast_v2_dynamic_buffer_model<T>::const_buffers_type;
+};
+
+}
+
+/// The most segments data() of a storage, or of a dynamic buffer, can return: 1, 2 or unbounded_segments
+template<class T>
+struct max_segments
+    : buffer_sequence_max_segments<typename detail::const_buffers_type_of<T>::type>
+{};
+
+/// True if data() of a storage, or of a dynamic buffer, always returns a single contiguous buffer
+template<class T>
+struct is_contiguous_storage
+    : std::integral_constant<bool, max_segments<T>::value == 1>
+{};
+
+namespace detail {
+
+template<class Storage>
+Storage *
+storage_of_model(beast_v2_dynamic_buffer_model<Storage> const &);
+
+// the storage behind a storage's dynamic buffer, or T itself
+template<class T, class = void>
+struct storage_type_of
+{
+    using type = T;
+};
+
+template<class T>
+struct storage_type_of<T, boost::void_t<decltype(storage_of_model(std::declval<T const &>()))>>
+{
+    using type = typename std::remove_pointer<decltype(storage_of_model(std::declval<T const &>()))>::type;
+};
+
+template<class T, class = void>
+struct declares_stable_growth
+    : std::false_type
+{};
+
+template<class T>
+struct declares_stable_growth<T, typename std::enable_if<T::stable_growth>::type>
+    : std::true_type
+{};
+
+}
+
+/// True if grow() on a storage, or on its dynamic buffer, never moves the readable bytes, so that
+/// buffers already returned by data() for them remain valid. Storages declare this with a public
+/// `static constexpr bool stable_growth = true`.
+template<class T>
+struct has_stable_growth
+    : detail::declares_stable_growth<typename detail::storage_type_of<T>::type>
+{};
+
+}
+}
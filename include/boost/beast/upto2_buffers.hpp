@@ -0,0 +1,67 @@
+#pragma once
+
+#include <boost/beast/core/detail/config.hpp>
+#include <boost/asio/buffer.hpp>
+#include <array>
+
+namespace boost {
+namespace beast {
+
+/// A buffer sequence of at most two buffers, as a region of a ring describes. basic_small_buffers
+/// (small_buffers.hpp) is the general form for any number of buffers.
+template<class BufferType>
+struct basic_upto2_buffers
+    {
+    using value_type = BufferType;
+    using storage_type = std::array<BufferType, 2>;
+    using iterator = typename storage_type::iterator;
+    using const_iterator = typename storage_type::const_iterator;
+
+    const_iterator
+    begin() const
+    { return store_.data(); }
+
+    iterator
+    begin()
+    { return store_.data(); }
+
+    const_iterator
+    end() const
+    { return begin() + size_; }
+
+    iterator
+    end()
+    { return begin() + size_; }
+
+public:
+    explicit basic_upto2_buffers(
+        BufferType b1 = {},
+        BufferType b2 = {})
+        : store_()
+        , size_(0)
+    {
+        maybe_append(b1);
+        maybe_append(b2);
+    }
+
+private:
+
+    void
+    maybe_append(BufferType b)
+    {
+        if (b.size() == 0)
+            return;
+
+        store_[size_++] = b;
+    }
+
+private:
+    storage_type store_;
+    std::size_t size_;
+};
+
+using mutable_upto2_buffers = basic_upto2_buffers<net::mutable_buffer>;
+using const_upto2_buffers = basic_upto2_buffers<net::const_buffer>;
+
+}
+}
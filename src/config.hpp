@@ -1,5 +1,7 @@
 #pragma once
 
+// Boost 1.74's asio/awaitable.hpp, included in C++20, uses std::exchange without including <utility>
+#include <utility>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/ssl.hpp>
@@ -11,15 +11,109 @@
 #include <boost/beast/multi_storage.hpp>
 #endif
 #if !NO_CIRCULAR_STORAGE
-//#include <boost/beast/circular_storage.hpp>
+#include <boost/beast/circular_storage.hpp>
 #endif
 #include <boost/beast/static_storage.hpp>
+#include <boost/beast/static_ring_storage.hpp>
+#include <boost/beast/mirrored_circular_storage.hpp>
+#include <boost/beast/mapped_file_storage.hpp>
+#include <boost/beast/spill_storage.hpp>
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+#include <sys/stat.h>
+#endif
 #include <boost/beast/multi_buffer_dynamic_proxy.hpp>
+#include <boost/beast/chunk_recycler.hpp>
+#include <boost/beast/small_buffers.hpp>
+#include <boost/beast/storage_traits.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
 
 #define CATCH_CONFIG_RUNNER
 
 #include <catch2/catch.hpp>
 
+// every allocation of the program is counted, for tests which check that a path allocates nothing.
+// Each form of new which can be paired with a replaced delete is replaced too, so that sanitizers see
+// matching allocations and deallocations.
+namespace {
+
+std::atomic<std::size_t> allocation_count{0};
+
+void *
+counted_allocate(std::size_t n) noexcept
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(n ? n : 1);
+}
+
+}
+
+void *
+operator new(std::size_t n)
+{
+    if (auto p = counted_allocate(n))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *
+operator new[](std::size_t n)
+{
+    if (auto p = counted_allocate(n))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *
+operator new(std::size_t n, std::nothrow_t const &) noexcept
+{
+    return counted_allocate(n);
+}
+
+void *
+operator new[](std::size_t n, std::nothrow_t const &) noexcept
+{
+    return counted_allocate(n);
+}
+
+void
+operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void *p, std::nothrow_t const &) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p, std::nothrow_t const &) noexcept
+{
+    std::free(p);
+}
+
 struct make_static
 {
     enum
@@ -69,6 +163,56 @@ struct make_circular
 };
 #endif
 
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+struct make_mirrored_circular
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 16
+    };
+
+    auto
+    operator()() const -> boost::beast::mirrored_circular_storage
+    {
+        return boost::beast::mirrored_circular_storage(max_capacity);
+    }
+};
+#endif
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+struct make_mapped_file
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 16
+    };
+
+    auto
+    operator()() const -> boost::beast::mapped_file_storage
+    {
+        return boost::beast::mapped_file_storage::temporary("/tmp", max_capacity);
+    }
+};
+
+// spills once it holds more than half its limit
+struct make_spill
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 16
+    };
+
+    auto
+    operator()() const -> boost::beast::spill_storage
+    {
+        return boost::beast::spill_storage(max_capacity / 2, "/tmp", max_capacity);
+    }
+};
+#endif
+
 #if !NO_MULTI_STORAGE
 struct make_multi
 {
@@ -86,6 +230,21 @@ struct make_multi
 };
 #endif
 
+struct make_static_ring
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 16
+    };
+
+    auto
+    operator()() const -> boost::beast::static_ring_storage<max_capacity>
+    {
+        return {};
+    }
+};
+
 struct make_beast_multi_buffer
 {
     enum
@@ -104,6 +263,7 @@ struct make_beast_multi_buffer
 
 using test_list = std::tuple<
     make_static
+    , make_static_ring
     , make_beast_multi_buffer
 #if !NO_FLAT_STORAGE
     , make_flat
@@ -113,6 +273,13 @@ using test_list = std::tuple<
 #endif
 #if !NO_MULTI_STORAGE
     , make_multi
+#endif
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+    , make_mirrored_circular
+#endif
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    , make_mapped_file
+    , make_spill
 #endif
     >;
 
@@ -170,6 +337,1068 @@ TEMPLATE_LIST_TEST_CASE("beast v2 dynamic buffer types", "", test_list)
     REQUIRE(net::buffer_size(output_region) == 0);
 }
 
+TEST_CASE("multi_buffer_dynamic_proxy data windows", "")
+{
+    using namespace boost::beast;
+
+    auto storage = multi_buffer();
+    auto dyn_buf = dynamic_buffer(storage);
+
+    auto expected = std::string();
+    for (char c = 'a'; c <= 'h'; ++c)
+    {
+        auto chunk = std::string(700, c);
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(chunk.size() + 100);
+        net::buffer_copy(dyn_buf.data(pos, chunk.size()), net::buffer(chunk));
+        dyn_buf.shrink(100);
+        expected += chunk;
+    }
+    auto readable = storage.data();
+    REQUIRE(std::distance(readable.begin(), readable.end()) > 1);
+
+    auto check_window = [&](std::size_t pos, std::size_t n)
+    {
+        auto window = dyn_buf.data(pos, n);
+        auto expect = expected.substr(pos, n);
+        CHECK(net::buffer_size(window) == expect.size());
+        CHECK(buffers_to_string(window) == expect);
+
+        auto reversed = std::string();
+        for (auto it = window.end(); it != window.begin();)
+        {
+            auto buf = net::const_buffer(*--it);
+            reversed.insert(0, static_cast<char const *>(buf.data()), buf.size());
+        }
+        CHECK(reversed == expect);
+    };
+
+    for (std::size_t pos : {0, 1, 699, 700, 701, 2000, 5599})
+        for (std::size_t n : {0, 1, 2, 699, 700, 1401, 5600})
+            check_window(pos, std::min(n, expected.size() - pos));
+
+    // the prepared region follows the readable bytes
+    auto pos = dyn_buf.size();
+    dyn_buf.grow(1000);
+    net::buffer_copy(dyn_buf.data(pos, 1000), net::buffer(std::string(1000, 'z')));
+    expected += std::string(1000, 'z');
+    check_window(pos - 10, 20);
+    check_window(0, expected.size());
+    dyn_buf.shrink(0);
+    check_window(0, expected.size());
+
+    dyn_buf.consume(1500);
+    expected.erase(0, 1500);
+    check_window(0, expected.size());
+    check_window(100, 1000);
+}
+
+TEST_CASE("multi_buffer_dynamic_proxy windows outlive their proxy", "")
+{
+    using namespace boost::beast;
+
+    auto storage = multi_buffer();
+    auto expected = std::string();
+    auto chunks = [&]
+    {
+        auto readable = storage.data();
+        return std::size_t(std::distance(readable.begin(), readable.end()));
+    };
+    for (int i = 0; chunks() <= multi_buffer_dynamic_proxy_base::chunk_index::inline_chunks; ++i)
+    {
+        auto chunk = std::string(std::size_t(300 + i * 50), char('a' + i % 26));
+        storage.commit(net::buffer_copy(storage.prepare(chunk.size()), net::buffer(chunk)));
+        expected += chunk;
+    }
+
+    // as net::async_write(stream, dynamic_buffer(mb).data(0, n), handler) keeps it
+    auto whole = dynamic_buffer(storage).data(0, storage.size());
+    auto few = dynamic_buffer(storage).data(1000, 700);
+
+    // taken before the proxy moves into an operation which then ends
+    auto proxy = dynamic_buffer(storage);
+    auto tail = proxy.data(storage.size() - 2000, 2000);
+    {
+        auto op_copy = std::move(proxy);
+        CHECK(op_copy.size() == expected.size());
+    }
+
+    CHECK(buffers_to_string(whole) == expected);
+    CHECK(buffers_to_string(few) == expected.substr(1000, 700));
+    CHECK(buffers_to_string(tail) == expected.substr(expected.size() - 2000));
+
+    auto reversed = std::string();
+    for (auto it = tail.end(); it != tail.begin();)
+    {
+        auto buf = net::const_buffer(*--it);
+        reversed.insert(0, static_cast<char const *>(buf.data()), buf.size());
+    }
+    CHECK(reversed == expected.substr(expected.size() - 2000));
+}
+
+TEST_CASE("multi_buffer_dynamic_proxy index follows changes made elsewhere", "")
+{
+    using namespace boost::beast;
+
+    auto storage = multi_buffer();
+    auto dyn_buf = dynamic_buffer(storage);
+    auto expected = std::string();
+
+    auto append = [&](decltype(dyn_buf) &target, std::string const &s)
+    {
+        auto pos = target.size();
+        target.grow(s.size());
+        net::buffer_copy(target.data(pos, s.size()), net::buffer(s));
+        target.shrink(0);
+        expected += s;
+    };
+
+    for (int i = 0; i < 200; ++i)
+        append(dyn_buf, std::to_string(i) + ':' + std::string(std::size_t(i % 7 * 100), 'x') + '\n');
+
+    auto check_tail = [&](std::size_t k)
+    {
+        CHECK(buffers_to_string(dyn_buf.data(dyn_buf.size() - k, k)) == expected.substr(expected.size() - k));
+    };
+    check_tail(1);
+    check_tail(1000);
+
+    // a copy's changes are seen
+    auto copy = dyn_buf;
+    append(copy, "copy\n");
+    copy.consume(5000);
+    expected.erase(0, 5000);
+    check_tail(expected.size());
+
+    // an unrelated proxy and the multi_buffer itself invalidate it
+    auto other = dynamic_buffer(storage);
+    append(other, "other\n");
+    other.consume(333);
+    expected.erase(0, 333);
+    check_tail(expected.size());
+
+    storage.commit(net::buffer_copy(storage.prepare(6), net::buffer(std::string("direct"))));
+    expected += "direct";
+    check_tail(10);
+    check_tail(expected.size());
+
+    dyn_buf.consume(expected.size());
+    expected.clear();
+    CHECK(net::buffer_size(dyn_buf.data(0, dyn_buf.size())) == 0);
+    append(dyn_buf, "again");
+    check_tail(5);
+}
+
+TEST_CASE("multi_buffer_dynamic_proxy made for each operation does not allocate", "")
+{
+    using namespace boost::beast;
+
+    // a few chunks of readable bytes, as a buffer holding part of a request has
+    auto storage = multi_buffer();
+    auto text = std::string();
+    for (char c = 'a'; c <= 'd'; ++c)
+    {
+        auto chunk = std::string(1000, c);
+        storage.commit(net::buffer_copy(storage.prepare(chunk.size()), net::buffer(chunk)));
+        text += chunk;
+    }
+    auto readable = storage.data();
+    REQUIRE(std::size_t(std::distance(readable.begin(), readable.end())) > 1);
+    REQUIRE(std::size_t(std::distance(readable.begin(), readable.end()))
+            <= multi_buffer_dynamic_proxy_base::chunk_index::inline_chunks);
+
+    // as each async_read_until would: a new proxy, which searches the data and consumes a line
+    char line[100];
+    auto mismatches = 0;
+    auto before = allocation_count.load();
+    for (std::size_t pos = 0; pos < text.size(); pos += sizeof(line))
+    {
+        auto dyn_buf = dynamic_buffer(storage);
+        net::buffer_copy(net::buffer(line), dyn_buf.data(0, sizeof(line)));
+        mismatches += text.compare(pos, sizeof(line), line, sizeof(line)) != 0;
+        auto op_copy = dyn_buf;
+        op_copy.consume(sizeof(line));
+    }
+    auto allocations = allocation_count.load() - before;
+    CHECK(mismatches == 0);
+    CHECK(allocations == 0);
+    CHECK(storage.size() == 0);
+}
+
+TEST_CASE("flat_storage consumes without moving data", "")
+{
+    using namespace boost::beast;
+
+    auto storage = flat_storage(1024);
+    auto dyn_buf = dynamic_buffer(storage);
+
+    auto append = [&](std::string const &s)
+    {
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(s.size());
+        net::buffer_copy(dyn_buf.data(pos, s.size()), net::buffer(s));
+    };
+
+    auto expected = std::string();
+    for (int i = 0; i < 100; ++i)
+    {
+        auto line = std::to_string(1000 + i) + "abcde\n";
+        append(line);
+        expected += line;
+    }
+
+    auto capacity = dyn_buf.capacity();
+    auto front = dyn_buf.data(0, dyn_buf.size()).data();
+    dyn_buf.consume(10);
+    expected.erase(0, 10);
+    CHECK(dyn_buf.data(0, dyn_buf.size()).data() == static_cast<char const *>(front) + 10);
+
+    // a steady stream of lines fits in the allocation by compacting
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto line = std::to_string(2000 + i) + "fghij\n";
+        append(line);
+        expected += line;
+        dyn_buf.consume(10);
+        expected.erase(0, 10);
+        REQUIRE(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == expected);
+    }
+    CHECK(dyn_buf.capacity() == capacity);
+
+    storage.compaction_threshold(1.0);
+    dyn_buf.consume(500);
+    expected.erase(0, 500);
+    append(std::string(500, 'x'));
+    expected += std::string(500, 'x');
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == expected);
+    CHECK(dyn_buf.capacity() == capacity);
+}
+
+TEST_CASE("growth policies", "")
+{
+    using namespace boost::beast;
+
+    CHECK(exact_growth()(100, 150, 1000) == 150);
+
+    CHECK(geometric_growth()(0, 10, 1000) == 10);
+    CHECK(geometric_growth()(100, 150, 1000) == 200);
+    CHECK(geometric_growth()(100, 300, 1000) == 300);
+    CHECK(geometric_growth(1.5)(100, 101, 1000) == 150);
+    CHECK(geometric_growth()(600, 601, 1000) == 1000);
+
+    CHECK(page_rounded_growth<>()(0, 10, 1 << 20) == 4096);
+    CHECK(page_rounded_growth<>()(4096, 4097, 1 << 20) == 8192);
+    CHECK(page_rounded_growth<exact_growth>(4096)(4096, 4097, 6000) == 6000);
+
+    CHECK(capped_growth<>()(100, 150, 1000) == 200);
+    CHECK(capped_growth<>()(400, 401, 1000) == 1000);
+}
+
+TEST_CASE("flat_storage growth, reserve and shrink_to_fit", "")
+{
+    using namespace boost::beast;
+
+    auto grows = [](basic_flat_storage<exact_growth> &storage)
+    {
+        auto dyn_buf = dynamic_buffer(storage);
+        for (int i = 0; i < 100; ++i)
+            dyn_buf.grow(4096);
+        return dyn_buf.capacity();
+    };
+
+    auto exact = basic_flat_storage<exact_growth>();
+    CHECK(grows(exact) == 100 * 4096);
+
+    auto storage = flat_storage(1 << 20);
+    auto dyn_buf = dynamic_buffer(storage);
+    dyn_buf.grow(4096);
+    dyn_buf.grow(4096);
+    dyn_buf.grow(4096);
+    CHECK(dyn_buf.capacity() == 4 * 4096);
+
+    storage.reserve(100000);
+    CHECK(dyn_buf.capacity() == 100000);
+    REQUIRE_THROWS_AS(storage.reserve((1 << 20) + 1), std::length_error);
+
+    net::buffer_copy(dyn_buf.data(0, 3 * 4096), net::buffer(std::string(3 * 4096, 'a')));
+    dyn_buf.consume(4096);
+    storage.shrink_to_fit();
+    CHECK(dyn_buf.capacity() == 2 * 4096);
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == std::string(2 * 4096, 'a'));
+
+    dyn_buf.consume(dyn_buf.size());
+    storage.shrink_to_fit();
+    CHECK(dyn_buf.capacity() == 0);
+}
+
+TEST_CASE("static_ring_storage wraps around", "")
+{
+    using namespace boost::beast;
+
+    auto storage = static_ring_storage<16>();
+    auto dyn_buf = dynamic_buffer(storage);
+
+    auto append = [&](std::string const &s)
+    {
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(s.size());
+        net::buffer_copy(dyn_buf.data(pos, s.size()), net::buffer(s));
+    };
+
+    append("0123456789ab");
+    dyn_buf.consume(10);
+    append("cdefghijkl");
+    CHECK(dyn_buf.size() == 12);
+
+    auto readable = dyn_buf.data(0, dyn_buf.size());
+    CHECK(std::distance(readable.begin(), readable.end()) == 2);
+    CHECK(buffers_to_string(readable) == "abcdefghijkl");
+    CHECK(buffers_to_string(dyn_buf.data(5, 4)) == "fghi");
+    CHECK(buffers_to_string(dyn_buf.data(2, 6)) == "cdefgh");
+
+    dyn_buf.consume(6);
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == "ghijkl");
+    dyn_buf.consume(6);
+    append("mnopqrstuvwxyz01");
+    readable = dyn_buf.data(0, dyn_buf.size());
+    CHECK(std::distance(readable.begin(), readable.end()) == 1);
+    REQUIRE_THROWS_AS(dyn_buf.grow(1), std::length_error);
+}
+
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+TEST_CASE("mirrored_circular_storage is contiguous across the wrap", "")
+{
+    using namespace boost::beast;
+
+    auto storage = mirrored_circular_storage(4096);
+    auto dyn_buf = dynamic_buffer(storage);
+    auto capacity = dyn_buf.capacity();
+    REQUIRE(capacity >= 4096);
+
+    auto append = [&](std::string const &s)
+    {
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(s.size());
+        auto region = dyn_buf.data(pos, s.size());
+        CHECK(std::distance(net::buffer_sequence_begin(region), net::buffer_sequence_end(region)) == 1);
+        net::buffer_copy(region, net::buffer(s));
+    };
+
+    auto expected = std::string(capacity / 2, '-');
+    append(expected);
+    for (int round = 0; round < 20; ++round)
+    {
+        auto chunk = std::string(capacity / 3 + std::size_t(round), char('a' + round));
+        append(chunk);
+        expected += chunk;
+        CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == expected);
+
+        dyn_buf.consume(chunk.size());
+        expected.erase(0, chunk.size());
+        CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == expected);
+    }
+}
+#endif
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+TEST_CASE("mapped_file_storage keeps its bytes in the file", "")
+{
+    using namespace boost::beast;
+
+    char path[] = "/tmp/beast-mapped-file-XXXXXX";
+    ::close(::mkstemp(path));
+
+    auto text = std::string();
+    for (int i = 0; text.size() < 3 * 1024 * 1024; ++i)
+        text += std::to_string(i) + '\n';
+
+    {
+        auto storage = mapped_file_storage(path, 1 << 30);
+        auto dyn_buf = dynamic_buffer(storage);
+
+        // reads of 64 KiB, as a read loop would make them
+        for (std::size_t pos = 0; pos < text.size(); pos += 65536)
+        {
+            auto n = std::min<std::size_t>(65536, text.size() - pos);
+            dyn_buf.grow(65536);
+            net::buffer_copy(dyn_buf.data(pos, n), net::buffer(text.data() + pos, n));
+            dyn_buf.shrink(65536 - n);
+        }
+        REQUIRE(dyn_buf.size() == text.size());
+        CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == text);
+
+        auto first = net::const_buffer(dyn_buf.data(0, 1)).data();
+        dyn_buf.consume(1000000);
+        CHECK(buffers_to_string(dyn_buf.data(0, 100)) == text.substr(1000000, 100));
+        CHECK(net::const_buffer(dyn_buf.data(0, 1)).data() == static_cast<char const *>(first) + 1000000);
+    }
+
+    // the file ends with the readable bytes; the whole pages consumed before them are holes
+    auto file = std::string();
+    auto fd = ::open(path, O_RDONLY);
+    REQUIRE(fd >= 0);
+    char chunk[65536];
+    for (ssize_t n; (n = ::read(fd, chunk, sizeof(chunk))) > 0;)
+        file.append(chunk, std::size_t(n));
+    ::close(fd);
+    ::unlink(path);
+    auto punched = std::size_t(1000000) / ::sysconf(_SC_PAGESIZE) * ::sysconf(_SC_PAGESIZE);
+    REQUIRE(file.size() == text.size());
+    CHECK(file.compare(punched, std::string::npos, text, punched, std::string::npos) == 0);
+    CHECK(file.find_first_not_of('\0') == punched);
+}
+
+TEST_CASE("mapped_file_storage keeps a file the size of its readable bytes", "")
+{
+    using namespace boost::beast;
+
+    // 64 MiB through a storage limited to 1 MiB, which always holds about 64 KiB
+    auto storage = mapped_file_storage::temporary("/tmp", 1024 * 1024);
+    auto dyn_buf = dynamic_buffer(storage);
+    auto chunk = std::string(4096, 'x');
+    std::size_t most_blocks = 0;
+    std::size_t most_length = 0;
+    for (std::size_t streamed = 0; streamed < 64 * 1024 * 1024; streamed += chunk.size())
+    {
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(chunk.size());
+        net::buffer_copy(dyn_buf.data(pos, chunk.size()), net::buffer(chunk));
+        if (dyn_buf.size() > 64 * 1024)
+            dyn_buf.consume(chunk.size() + 100);
+        REQUIRE(dyn_buf.size() > 0);
+
+        struct stat st;
+        REQUIRE(::fstat(storage.native_handle(), &st) == 0);
+        most_blocks = std::max(most_blocks, std::size_t(st.st_blocks) * 512);
+        most_length = std::max(most_length, std::size_t(st.st_size));
+    }
+
+    CHECK(most_length <= 2 * 1024 * 1024);
+    CHECK(most_blocks <= 1024 * 1024);
+}
+
+TEST_CASE("mapped_file_storage reserves the blocks it writes to", "")
+{
+    using namespace boost::beast;
+
+    auto storage = mapped_file_storage::temporary("/tmp", 1024 * 1024);
+    auto dyn_buf = dynamic_buffer(storage);
+    auto reserved = [&] {
+        struct stat st;
+        REQUIRE(::fstat(storage.native_handle(), &st) == 0);
+        return std::size_t(st.st_blocks) * 512 >= std::size_t(st.st_size);
+    };
+
+    dyn_buf.grow(100000);
+    CHECK(reserved());
+
+    // the consumed pages are punched out, and reserved again before the bytes move back over them
+    dyn_buf.consume(100000);
+    CHECK(!reserved());
+    dyn_buf.grow(8192);
+    CHECK(reserved());
+}
+
+TEST_CASE("spill_storage spills to a file past its memory threshold", "")
+{
+    using namespace boost::beast;
+
+    auto text = std::string();
+    for (int i = 0; text.size() < 1024 * 1024; ++i)
+        text += std::to_string(i) + '\n';
+
+    auto storage = spill_storage(64 * 1024, "/tmp", 4 * 1024 * 1024);
+    auto dyn_buf = dynamic_buffer(storage);
+
+    // reads of 4 KiB, as a read loop would make them; none fails at the threshold
+    for (std::size_t pos = 0; pos < text.size(); pos += 4096)
+    {
+        auto n = std::min<std::size_t>(4096, text.size() - pos);
+        dyn_buf.grow(4096);
+        net::buffer_copy(dyn_buf.data(pos, n), net::buffer(text.data() + pos, n));
+        dyn_buf.shrink(4096 - n);
+        CHECK(storage.spilled() == (dyn_buf.size() > storage.memory_threshold()));
+    }
+    REQUIRE(dyn_buf.size() == text.size());
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == text);
+
+    dyn_buf.consume(1000000);
+    CHECK(storage.spilled());
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == text.substr(1000000));
+
+    // emptied, it returns to memory
+    dyn_buf.consume(dyn_buf.size());
+    CHECK(!storage.spilled());
+    dyn_buf.grow(5);
+    net::buffer_copy(dyn_buf.data(0, 5), net::buffer("hello", 5));
+    CHECK(!storage.spilled());
+    CHECK(buffers_to_string(dyn_buf.data(0, 5)) == "hello");
+
+    // only the limit is enforced
+    CHECK_THROWS_AS(dyn_buf.grow(4 * 1024 * 1024), std::length_error);
+    dyn_buf.grow(4 * 1024 * 1024 - 5);
+    CHECK(storage.spilled());
+    CHECK(buffers_to_string(dyn_buf.data(0, 5)) == "hello");
+}
+
+TEST_CASE("many spill_storages spill at once", "")
+{
+    using namespace boost::beast;
+
+    // as many connections each holding a request larger than its threshold
+    auto storages = std::vector<std::unique_ptr<spill_storage>>();
+    for (int i = 0; i < 500; ++i)
+    {
+        storages.emplace_back(new spill_storage(4096));
+        auto dyn_buf = dynamic_buffer(*storages.back());
+        auto text = std::to_string(i);
+        text.resize(64 * 1024, '.');
+        dyn_buf.grow(text.size());
+        net::buffer_copy(dyn_buf.data(0, text.size()), net::buffer(text));
+        REQUIRE(storages.back()->spilled());
+    }
+
+    for (std::size_t i = 0; i < storages.size(); ++i)
+    {
+        auto dyn_buf = dynamic_buffer(*storages[i]);
+        REQUIRE(dyn_buf.size() == 64 * 1024);
+        auto text = buffers_to_string(dyn_buf.data(0, dyn_buf.size()));
+        CHECK(text.compare(0, std::to_string(i).size(), std::to_string(i)) == 0);
+        dyn_buf.consume(dyn_buf.size());
+        CHECK(!storages[i]->spilled());
+    }
+}
+#endif
+
+TEST_CASE("multi_storage chunk list", "")
+{
+    using namespace boost::beast;
+
+    auto storage = multi_storage();
+    auto dyn_buf = dynamic_buffer(storage);
+    auto expected = std::string();
+
+    auto append = [&](std::string const &s, std::size_t slack)
+    {
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(s.size() + slack);
+        net::buffer_copy(dyn_buf.data(pos, s.size()), net::buffer(s));
+        dyn_buf.shrink(slack);
+        expected += s;
+    };
+
+    auto check_window = [&](std::size_t pos, std::size_t n)
+    {
+        auto window = dyn_buf.data(pos, n);
+        CHECK(buffers_to_string(window) == expected.substr(pos, n));
+
+        auto reversed = std::string();
+        for (auto it = window.end(); it != window.begin();)
+        {
+            auto buf = net::const_buffer(*--it);
+            reversed.insert(0, static_cast<char const *>(buf.data()), buf.size());
+        }
+        CHECK(reversed == expected.substr(pos, n));
+    };
+
+    for (int i = 0; i < 300; ++i)
+        append(std::to_string(i) + ':' + std::string(std::size_t(i % 13 * 40), char('a' + i % 26)) + '\n',
+               std::size_t(i % 5 * 1000));
+
+    auto readable = dyn_buf.data(0, dyn_buf.size());
+    REQUIRE(std::distance(readable.begin(), readable.end()) > 10);
+    CHECK(dyn_buf.size() == expected.size());
+
+    for (std::size_t pos : {std::size_t(0), std::size_t(1), std::size_t(1019), expected.size() / 3,
+                            expected.size() - 5000, expected.size() - 1})
+        for (std::size_t n : {0, 1, 2, 1000, 5000, 1 << 20})
+            check_window(pos, std::min(n, expected.size() - pos));
+
+    dyn_buf.consume(2500);
+    expected.erase(0, 2500);
+    check_window(0, expected.size());
+    check_window(100, 10000);
+
+    dyn_buf.shrink(7000);
+    expected.resize(expected.size() - 7000);
+    check_window(0, expected.size());
+    check_window(expected.size() - 3000, 3000);
+
+    dyn_buf.consume(expected.size());
+    CHECK(dyn_buf.size() == 0);
+    expected.clear();
+    append("again", 0);
+    check_window(0, 5);
+}
+
+#if BOOST_BEAST_HAS_STD_PMR
+TEST_CASE("storages allocate through a memory resource", "")
+{
+    using namespace boost::beast;
+
+    struct counting_resource
+        : std::pmr::memory_resource
+    {
+        std::size_t outstanding = 0;
+        std::size_t allocations = 0;
+
+        void *
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            ++allocations;
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void
+        do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+        {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool
+        do_is_equal(std::pmr::memory_resource const &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    auto exercise = [](auto &storage)
+    {
+        auto dyn_buf = dynamic_buffer(storage);
+        for (int i = 0; i < 50; ++i)
+        {
+            auto line = std::string(std::size_t(i * 37 % 500), 'x') + "\r\n";
+            auto pos = dyn_buf.size();
+            dyn_buf.grow(line.size());
+            net::buffer_copy(dyn_buf.data(pos, line.size()), net::buffer(line));
+            dyn_buf.consume(line.size() / 2);
+        }
+        CHECK(dyn_buf.size() > 0);
+    };
+
+    auto resource = counting_resource();
+    {
+        auto flat = pmr::flat_storage(1 << 20, &resource);
+        exercise(flat);
+        CHECK(flat.get_allocator().resource() == &resource);
+        CHECK(resource.allocations > 0);
+        CHECK(resource.outstanding == dynamic_buffer(flat).capacity());
+    }
+    CHECK(resource.outstanding == 0);
+
+    resource.allocations = 0;
+    {
+        auto circular = pmr::circular_storage(1 << 16, &resource);
+        exercise(circular);
+        CHECK(resource.allocations == 1);
+        CHECK(resource.outstanding == 1 << 16);
+    }
+    CHECK(resource.outstanding == 0);
+
+    resource.allocations = 0;
+    {
+        auto multi = pmr::multi_storage(1 << 20, &resource);
+        exercise(multi);
+        CHECK(resource.allocations > 1);
+        auto moved = std::move(multi);
+        exercise(moved);
+    }
+    CHECK(resource.outstanding == 0);
+
+    // polymorphic_allocator does not propagate: move assignment copies into the target's resource
+    auto other = counting_resource();
+    {
+        auto source = pmr::flat_storage(1 << 20, &resource);
+        auto target = pmr::flat_storage(1 << 20, &other);
+        exercise(source);
+        exercise(target);
+        auto expected = buffers_to_string(dynamic_buffer(source).data(0, dynamic_buffer(source).size()));
+
+        target = std::move(source);
+        CHECK(target.get_allocator().resource() == &other);
+        CHECK(buffers_to_string(dynamic_buffer(target).data(0, dynamic_buffer(target).size())) == expected);
+        CHECK(resource.outstanding == 0);
+        CHECK(other.outstanding == dynamic_buffer(target).capacity());
+        exercise(target);
+
+        auto ring_source = pmr::circular_storage(1 << 12, &resource);
+        auto ring_target = pmr::circular_storage(1 << 12, &other);
+        ring_target = std::move(ring_source);
+        CHECK(resource.outstanding == 0);
+        CHECK(other.outstanding == dynamic_buffer(target).capacity() + (1 << 12));
+    }
+    CHECK(resource.outstanding == 0);
+    CHECK(other.outstanding == 0);
+}
+#endif
+
+TEST_CASE("chunk_recycler shares blocks between storages and threads", "")
+{
+    using namespace boost::beast;
+
+    CHECK(chunk_recycler::block_size(1) == 256);
+    CHECK(chunk_recycler::block_size(4000) == 4096);
+    CHECK(chunk_recycler::block_size(4096) == 4096);
+    CHECK(chunk_recycler::block_size(5u << 20) == 5u << 20);
+
+    auto p = chunk_recycler::allocate(4096);
+    chunk_recycler::deallocate(p, 4096);
+    CHECK(chunk_recycler::allocate(3000) == p);
+    chunk_recycler::deallocate(p, 3000);
+
+    // a chunk released by multi_storage is reused by a flat_storage of the same size class
+    auto before = chunk_recycler::thread_cached_blocks(1024);
+    {
+        auto multi = basic_multi_storage<recycling_allocator<char>>();
+        auto dyn_buf = dynamic_buffer(multi);
+        dyn_buf.grow(100);
+        CHECK(chunk_recycler::thread_cached_blocks(1024) == (before ? before - 1 : 0));
+    }
+    CHECK(chunk_recycler::thread_cached_blocks(1024) == std::max<std::size_t>(before, 1));
+    {
+        auto flat = basic_flat_storage<exact_growth, recycling_allocator<char>>();
+        dynamic_buffer(flat).grow(1000);
+        CHECK(chunk_recycler::thread_cached_blocks(1024) == std::max<std::size_t>(before, 1) - 1);
+    }
+
+    // so does a multi_buffer, through its proxy: the blocks of one buffer serve the next
+    auto cached_blocks = []
+    {
+        std::size_t n = 0;
+        for (auto size = chunk_recycler::block_size(1); size <= (1u << 20); size *= 2)
+            n += chunk_recycler::thread_cached_blocks(size);
+        return n;
+    };
+    auto read_through_proxy = [&](bool check)
+    {
+        auto proxied = basic_multi_buffer<recycling_allocator<char>>();
+        auto proxy = dynamic_buffer(proxied);
+        auto cached = cached_blocks();
+        proxy.grow(10000);
+        proxy.shrink(0);
+        if (check)
+            CHECK(cached_blocks() < cached);
+        proxy.consume(10000);
+    };
+    read_through_proxy(false);
+    auto recycled = cached_blocks();
+    read_through_proxy(true);
+    CHECK(cached_blocks() == recycled);
+
+    // the caches are bounded; the overflow, and the cache of an exiting thread, go to the global pool
+    constexpr std::size_t big = 512 * 1024;
+    auto global_before = chunk_recycler::global_cached_blocks(big);
+    std::size_t thread_cached = 0;
+    std::thread([&]
+    {
+        std::vector<void *> blocks;
+        for (int i = 0; i < 20; ++i)
+            blocks.push_back(chunk_recycler::allocate(big));
+        for (auto b : blocks)
+            chunk_recycler::deallocate(b, big);
+        thread_cached = chunk_recycler::thread_cached_blocks(big);
+    }).join();
+    CHECK(thread_cached <= 4);
+    CHECK(chunk_recycler::global_cached_blocks(big) == global_before + 20);
+
+    auto local_before = chunk_recycler::thread_cached_blocks(big);
+    chunk_recycler::deallocate(chunk_recycler::allocate(big), big);
+    CHECK(chunk_recycler::thread_cached_blocks(big) > local_before);
+    CHECK(chunk_recycler::global_cached_blocks(big) < global_before + 20);
+}
+
+TEST_CASE("splice moves whole chunks between storages", "")
+{
+    using namespace boost::beast;
+
+    auto pattern = std::string();
+    for (int i = 0; pattern.size() < (1 << 20); ++i)
+        pattern += std::to_string(i) + ',';
+
+    auto fill = [](multi_storage &storage, std::string const &s)
+    {
+        auto dyn_buf = dynamic_buffer(storage);
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(s.size());
+        net::buffer_copy(dyn_buf.data(pos, s.size()), net::buffer(s));
+    };
+
+    auto source = multi_storage();
+    fill(source, pattern);
+    dynamic_buffer(source).consume(100);
+
+    auto destination = basic_multi_storage<std::allocator<char>, counting_storage_stats>();
+    auto destination_buf = dynamic_buffer(destination);
+    destination_buf.grow(10);
+    net::buffer_copy(destination_buf.data(0, 10), net::buffer("0123456789", 10));
+
+    auto n = pattern.size() - 5000;
+    CHECK(destination.splice(source, n) == n);
+    CHECK(buffers_to_string(destination_buf.data(0, destination_buf.size())) == "0123456789" + pattern.substr(100, n));
+    CHECK(buffers_to_string(dynamic_buffer(source).data(0, dynamic_buffer(source).size())) == pattern.substr(100 + n));
+    // only the partly consumed first chunk and the partly moved last chunk are copied
+    CHECK(destination.stats().counters().bytes_moved <= 2 * 64 * 1024);
+
+    // the rest, and then nothing
+    CHECK(destination.splice(source, std::size_t(-1)) == pattern.size() - 100 - n);
+    CHECK(dynamic_buffer(source).size() == 0);
+    CHECK(destination.splice(source, 10) == 0);
+    CHECK(buffers_to_string(destination_buf.data(0, destination_buf.size())) == "0123456789" + pattern.substr(100));
+
+    // the source remains usable
+    fill(source, "more");
+    CHECK(buffers_to_string(dynamic_buffer(source).data(0, 4)) == "more");
+
+    auto limited = multi_storage(2);
+    CHECK_THROWS_AS(limited.splice(source, 4), std::length_error);
+}
+
+TEST_CASE("splice between multi_buffers", "")
+{
+    using namespace boost::beast;
+
+    auto source = multi_buffer();
+    auto destination = multi_buffer(1 << 20);
+    auto source_buf = dynamic_buffer(source);
+    auto destination_buf = dynamic_buffer(destination);
+
+    source_buf.grow(3000);
+    net::buffer_copy(source_buf.data(0, 3000), net::buffer(std::string(3000, 'x')));
+    source_buf.shrink(0);
+
+    // all of the source into an empty buffer moves the chunks
+    auto chunk = net::const_buffer(*source.data().begin()).data();
+    CHECK(destination_buf.splice(source_buf, 5000) == 3000);
+    CHECK(source_buf.size() == 0);
+    CHECK(destination_buf.size() == 3000);
+    CHECK(net::const_buffer(*destination.data().begin()).data() == chunk);
+    CHECK(destination.max_size() == std::size_t(1 << 20));
+
+    // otherwise the bytes are copied
+    source_buf.grow(4);
+    net::buffer_copy(source_buf.data(0, 4), net::buffer("abcd", 4));
+    source_buf.shrink(0);
+    CHECK(destination_buf.splice(source_buf, 2) == 2);
+    CHECK(buffers_to_string(destination_buf.data(2998, 4)) == "xxab");
+    CHECK(buffers_to_string(source_buf.data(0, source_buf.size())) == "cd");
+}
+
+#if BOOST_BEAST_HAS_STD_PMR
+TEST_CASE("splice copies between storages with different memory resources", "")
+{
+    using namespace boost::beast;
+
+    auto upstream = std::pmr::unsynchronized_pool_resource();
+    auto downstream = std::pmr::unsynchronized_pool_resource();
+    auto source = pmr::multi_storage(&upstream);
+    auto destination = pmr::multi_storage(&downstream);
+
+    auto text = std::string(100000, 'q') + "end";
+    dynamic_buffer(source).grow(text.size());
+    net::buffer_copy(dynamic_buffer(source).data(0, text.size()), net::buffer(text));
+
+    CHECK(destination.splice(source, text.size()) == text.size());
+    CHECK(buffers_to_string(dynamic_buffer(destination).data(0, text.size())) == text);
+    CHECK(dynamic_buffer(source).size() == 0);
+}
+#endif
+
+TEST_CASE("storage stats policies", "")
+{
+    using namespace boost::beast;
+
+    static_assert(sizeof(static_storage<16>) == sizeof(std::size_t) + 16, "no_storage_stats takes no space");
+    static_assert(sizeof(flat_storage) == sizeof(basic_flat_storage<geometric_growth, std::allocator<char>,
+                                                                    no_storage_stats>), "");
+
+    counting_storage_stats::reset_thread_snapshot();
+
+    auto flat = basic_flat_storage<exact_growth, std::allocator<char>, counting_storage_stats>(1 << 20);
+    auto flat_buf = dynamic_buffer(flat);
+    flat.compaction_threshold(1.0);
+    flat_buf.grow(100);
+    flat_buf.grow(100);
+    flat_buf.consume(150);
+    flat_buf.grow(150);     // compacts the remaining 50 bytes rather than reallocating
+    CHECK(flat.stats().counters().allocations == 1);
+    CHECK(flat.stats().counters().reallocations == 1);
+    CHECK(flat.stats().counters().bytes_moved == 100 + 50);
+    CHECK(flat.stats().counters().peak_size == 200);
+    CHECK(flat.stats().counters().peak_capacity == 200);
+    CHECK(flat.stats().counters().grows == 3);
+    CHECK(flat.stats().counters().consumes == 1);
+
+    auto fixed = static_storage<16, counting_storage_stats>();
+    auto fixed_buf = dynamic_buffer(fixed);
+    fixed_buf.grow(10);
+    net::buffer_copy(fixed_buf.data(0, 10), net::buffer("0123456789", 10));
+    fixed_buf.consume(4);
+    CHECK(buffers_to_string(fixed_buf.data(0, 6)) == "456789");
+    CHECK(fixed.stats().counters().bytes_moved == 6);
+    CHECK(fixed.stats().counters().datas == 2);
+
+    auto multi = basic_multi_storage<std::allocator<char>, counting_storage_stats>();
+    dynamic_buffer(multi).grow(5000);
+    CHECK(multi.stats().counters().allocations == 1);
+
+    auto thread = counting_storage_stats::thread_snapshot();
+    CHECK(thread.allocations == 2);
+    CHECK(thread.reallocations == 1);
+    CHECK(thread.bytes_moved == 156);
+    CHECK(thread.peak_size == 5000);
+    CHECK(thread.grows == 5);
+    CHECK(thread.datas == 2);
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    // the storages outside the heap report the same counters
+    auto spill = basic_spill_storage<counting_storage_stats>(4096);
+    auto spill_buf = dynamic_buffer(spill);
+    spill_buf.grow(4000);
+    spill_buf.grow(1000);   // spills the first 4000 bytes to the file
+    spill_buf.consume(4500);
+    CHECK(spill.stats().counters().allocations == 1);
+    CHECK(spill.stats().counters().bytes_moved == 4000);
+    CHECK(spill.stats().counters().peak_size == 5000);
+    CHECK(spill.stats().counters().grows == 2);
+    CHECK(spill.stats().counters().consumes == 1);
+#endif
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+    auto mirrored = basic_mirrored_circular_storage<counting_storage_stats>(4096);
+    dynamic_buffer(mirrored).grow(100);
+    CHECK(mirrored.stats().counters().allocations == 1);
+    CHECK(mirrored.stats().counters().peak_size == 100);
+
+    // moving a storage moves its counters
+    auto moved_mirrored = std::move(mirrored);
+    CHECK(moved_mirrored.stats().counters().allocations == 1);
+    CHECK(moved_mirrored.stats().counters().grows == 1);
+#endif
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    auto mapped = basic_mapped_file_storage<counting_storage_stats>::temporary("/tmp", 1 << 20);
+    dynamic_buffer(mapped).grow(100);
+    auto moved_mapped = std::move(mapped);
+    CHECK(moved_mapped.stats().counters().allocations == 1);
+    CHECK(moved_mapped.stats().counters().grows == 1);
+#endif
+}
+
+TEST_CASE("small_buffers", "")
+{
+    using namespace boost::beast;
+
+    auto storage = multi_storage();
+    auto dyn_buf = dynamic_buffer(storage);
+    auto text = std::string();
+    for (int i = 0; i < 3; ++i)
+    {
+        auto piece = std::string(900, char('a' + i));
+        dyn_buf.grow(piece.size());
+        net::buffer_copy(dyn_buf.data(dyn_buf.size() - piece.size(), piece.size()), net::buffer(piece));
+        text += piece;
+    }
+
+    auto window = dyn_buf.data(0, dyn_buf.size());
+    auto few = const_small_buffers<4>(window);
+    CHECK(few.size() == std::size_t(std::distance(window.begin(), window.end())));
+    CHECK(!few.spilled());
+    CHECK(few.bytes() == text.size());
+    CHECK(buffers_to_string(few) == text);
+    CHECK(std::string(net::buffers_begin(few), net::buffers_end(few)) == text);
+
+    auto one = const_small_buffers<1>(window);
+    CHECK(one.spilled());
+    CHECK(buffers_to_string(one) == text);
+    auto moved = std::move(one);
+    CHECK(one.empty());
+    CHECK(buffers_to_string(moved) == text);
+
+    auto upto2 = const_small_buffers<2>(const_upto2_buffers(net::const_buffer("ab", 2), net::const_buffer()));
+    CHECK(upto2.size() == 1);
+
+    auto many = mutable_small_buffers<4>();
+    char byte;
+    for (std::size_t i = 0; i < max_iov_buffers; ++i)
+        REQUIRE(many.push_back(net::mutable_buffer(&byte, 1)));
+    CHECK(!many.push_back(net::mutable_buffer(&byte, 1)));
+    CHECK(many.size() == max_iov_buffers);
+}
+
+TEST_CASE("small_flat_storage holds small payloads inline", "")
+{
+    using namespace boost::beast;
+
+    static_assert(sizeof(flat_storage) < sizeof(small_flat_storage<64>), "");
+
+    auto storage = basic_flat_storage<exact_growth, std::allocator<char>, counting_storage_stats, 64>(1 << 20);
+    auto dyn_buf = dynamic_buffer(storage);
+    static_assert(net::is_dynamic_buffer_v2<decltype(dyn_buf)>::value, "");
+    CHECK(dyn_buf.capacity() == 64);
+
+    auto append = [&](std::string const &s)
+    {
+        auto pos = dyn_buf.size();
+        dyn_buf.grow(s.size());
+        net::buffer_copy(dyn_buf.data(pos, s.size()), net::buffer(s));
+    };
+
+    auto const status = std::string("HTTP/1.1 200 OK\r\n");
+    for (int i = 0; i < 10; ++i)
+    {
+        append(status);
+        append(status);
+        CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == status + status);
+        dyn_buf.consume(dyn_buf.size());
+    }
+    CHECK(storage.stats().counters().allocations == 0);
+    auto inline_data = dyn_buf.data(0, 0).data();
+
+    append(std::string(40, 'a'));
+    append(std::string(40, 'b'));
+    CHECK(storage.stats().counters().allocations == 1);
+    CHECK(dyn_buf.capacity() == 80);
+    CHECK(buffers_to_string(dyn_buf.data(0, 80)) == std::string(40, 'a') + std::string(40, 'b'));
+
+    dyn_buf.consume(50);
+    storage.shrink_to_fit();
+    CHECK(dyn_buf.capacity() == 64);
+    CHECK(dyn_buf.data(0, 30).data() == inline_data);
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == std::string(30, 'b'));
+}
+
+TEST_CASE("storage contiguity traits", "")
+{
+    using namespace boost::beast;
+
+    static_assert(is_contiguous_storage<static_storage<16>>::value, "");
+    static_assert(is_contiguous_storage<flat_storage>::value, "");
+    static_assert(is_contiguous_storage<small_flat_storage<64>>::value, "");
+    static_assert(is_contiguous_storage<flat_storage_dynamic_buffer>::value, "");
+    static_assert(max_segments<static_ring_storage<16>>::value == 2, "");
+    static_assert(max_segments<circular_storage>::value == 2, "");
+    static_assert(max_segments<circular_storage_dynamic_buffer>::value == 2, "");
+    static_assert(max_segments<multi_storage>::value == unbounded_segments, "");
+    static_assert(max_segments<multi_buffer_dynamic_proxy<std::allocator<char>>>::value == unbounded_segments, "");
+    static_assert(!is_contiguous_storage<multi_storage_dynamic_buffer>::value, "");
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+    static_assert(is_contiguous_storage<mirrored_circular_storage>::value, "");
+#endif
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    static_assert(is_contiguous_storage<mapped_file_storage_dynamic_buffer>::value, "");
+    static_assert(is_contiguous_storage<spill_storage_dynamic_buffer>::value, "");
+#endif
+    static_assert(buffer_sequence_max_segments<const_small_buffers<4>>::value == unbounded_segments, "");
+    static_assert(buffer_sequence_max_segments<std::array<net::const_buffer, 3>>::value == 3, "");
+
+    static_assert(has_stable_growth<circular_storage>::value, "");
+    static_assert(has_stable_growth<multi_storage_dynamic_buffer>::value, "");
+    static_assert(has_stable_growth<static_ring_storage_dynamic_buffer<std::integral_constant<std::size_t, 16>>>::value, "");
+    static_assert(!has_stable_growth<flat_storage>::value, "");
+    static_assert(!has_stable_growth<flat_storage_dynamic_buffer>::value, "");
+    static_assert(!has_stable_growth<multi_buffer_dynamic_proxy<std::allocator<char>>>::value, "");
+}
+
 
 int
 main(
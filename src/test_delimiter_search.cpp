@@ -0,0 +1,129 @@
+#include "config.hpp"
+#include <catch2/catch.hpp>
+#include <boost/beast/delimiter_search.hpp>
+#include <random>
+#include <vector>
+
+namespace {
+
+using namespace boost::beast;
+
+std::vector<detail::delimiter_search_kernel>
+available_kernels()
+{
+    auto result = std::vector<detail::delimiter_search_kernel>{&detail::delimiter_search_scalar};
+#if BOOST_BEAST_DELIMITER_SEARCH_SSE2
+    result.push_back(&detail::delimiter_search_sse2);
+#endif
+#if BOOST_BEAST_DELIMITER_SEARCH_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        result.push_back(&detail::delimiter_search_avx2);
+#endif
+    return result;
+}
+
+// split text into segments of random length, some of them empty
+std::vector<net::const_buffer>
+segment(
+    std::string const &text,
+    std::mt19937 &rng,
+    std::size_t max_segment)
+{
+    auto result = std::vector<net::const_buffer>();
+    auto dist = std::uniform_int_distribution<std::size_t>(0, max_segment);
+    for (std::size_t pos = 0; pos < text.size();)
+    {
+        auto n = std::min(dist(rng), text.size() - pos);
+        result.emplace_back(text.data() + pos, n);
+        pos += n;
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("delimiter_search matches std::string::find", "")
+{
+    auto rng = std::mt19937(42);
+    auto delimiters = {std::string("\n"), std::string("\r\n"), std::string("\r\n\r\n"), std::string("abcabd"),
+                       std::string("abcabcabcabcabcabcabd")};
+
+    for (auto kernel : available_kernels())
+    {
+        for (auto const &delim : delimiters)
+        {
+            for (int round = 0; round < 200; ++round)
+            {
+                // a small alphabet drawn from the delimiter makes partial matches common
+                auto alphabet = delim + "xy";
+                auto pick = std::uniform_int_distribution<std::size_t>(0, alphabet.size() - 1);
+                auto length = std::uniform_int_distribution<std::size_t>(0, 300)(rng);
+                auto text = std::string();
+                for (std::size_t i = 0; i < length; ++i)
+                    text += alphabet[pick(rng)];
+
+                auto found = text.find(delim);
+                auto expected = found == std::string::npos ? std::size_t(0) : found + delim.size();
+
+                auto max_segment = std::size_t(round % 2 ? 3 : 80);
+                auto segments = segment(text, rng, max_segment);
+                CHECK(delimiter_search(delim, kernel).search(segments) == expected);
+
+                // the same segments presented over several calls
+                auto search = delimiter_search(delim, kernel);
+                auto result = std::size_t(0);
+                for (auto const &seg : segments)
+                {
+                    result = search.search(net::const_buffer(seg));
+                    if (result)
+                        break;
+                }
+                CHECK(result == expected);
+                if (!result)
+                    CHECK(search.searched() == text.size());
+            }
+        }
+    }
+}
+
+TEST_CASE("search_delimiter over a single buffer", "")
+{
+    auto text = std::string(1000, 'x') + "\r\n";
+    CHECK(search_delimiter(net::buffer(text), "\r\n") == text.size());
+    CHECK(search_delimiter(net::buffer(text), "\n\n") == 0);
+    CHECK(search_delimiter(net::const_buffer(), "\n") == 0);
+}
+
+TEST_CASE("delimiter_search over contiguous growing data", "")
+{
+    auto rng = std::mt19937(7);
+    for (auto kernel : available_kernels())
+    {
+        for (auto delim : {std::string("\r\n"), std::string("\r\n\r\n"), std::string("abcabd")})
+        {
+            for (int round = 0; round < 100; ++round)
+            {
+                auto alphabet = delim + "xy";
+                auto pick = std::uniform_int_distribution<std::size_t>(0, alphabet.size() - 1);
+                auto text = std::string();
+                for (std::size_t i = 0, n = std::uniform_int_distribution<std::size_t>(0, 200)(rng); i < n; ++i)
+                    text += alphabet[pick(rng)];
+
+                auto found = text.find(delim);
+                auto expected = found == std::string::npos ? std::size_t(0) : found + delim.size();
+
+                // the visible prefix grows by a few bytes at a time, as reads arrive
+                auto search = delimiter_search(delim, kernel);
+                auto result = std::size_t(0);
+                auto step = std::uniform_int_distribution<std::size_t>(0, 5);
+                for (std::size_t size = 0; ; size = std::min(text.size(), size + step(rng)))
+                {
+                    result = search.search_contiguous(text.data(), size);
+                    if (result || size == text.size())
+                        break;
+                }
+                CHECK(result == expected);
+            }
+        }
+    }
+}
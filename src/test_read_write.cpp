@@ -10,173 +10,44 @@
 #include <boost/beast/multi_storage.hpp>
 #endif
 #if !NO_CIRCULAR_STORAGE
-//#include <boost/beast/circular_storage.hpp>
+#include <boost/beast/circular_storage.hpp>
 #endif
 #include <boost/beast/static_storage.hpp>
+#include <boost/beast/static_ring_storage.hpp>
+#include <boost/beast/mirrored_circular_storage.hpp>
+#include <boost/beast/mapped_file_storage.hpp>
+#include <boost/beast/spill_storage.hpp>
 #include <boost/beast/multi_buffer_dynamic_proxy.hpp>
+#include <boost/beast/read_until.hpp>
+#include <boost/beast/read_until_awaitable.hpp>
+#include <boost/beast/read_lines.hpp>
+#include <boost/beast/coalescing_writer.hpp>
 
 namespace project_test {
 
 using namespace boost::beast;
 
-template<class Stream,
-    class BeastV2DynamicBuffer,
-    class Handler>
-struct read_until_crlf_op
-    : boost::asio::coroutine
-      , async_base<Handler, boost::beast::executor_type<Stream>>
-{
-    static constexpr std::size_t
-    chunk_size()
-    { return 4096; }
-
-    read_until_crlf_op(
-        Stream &stream,
-        BeastV2DynamicBuffer dyn_buf,
-        Handler handler)
-        : async_base<Handler,
-        boost::beast::executor_type<Stream>>(
-        std::move(handler),
-        stream.get_executor())
-        , stream_(stream)
-        , dyn_buf_(dyn_buf)
-    {
-        (*this)(error_code(), 0);
-    }
-
-#include <boost/asio/yield.hpp>
+using boost::beast::async_read_until;
+using boost::beast::async_read_until_crlf;
+using boost::beast::adaptive_read_size;
+using boost::beast::async_read_lines;
 
-    void
-    operator()(
-        boost::beast::error_code ec,
-        std::size_t bytes_transferred)
+struct make_static
+{
+    enum
+        : std::size_t
     {
-        reenter(this)
-        for (;;)
-        {
-            end_of_sequence_ = find_crlf();
-            if (end_of_sequence_)
-                goto completion;
-
-            to_read_ = std::min(chunk_size(), dyn_buf_.max_size() - dyn_buf_.size());
-
-            if (to_read_ == 0)
-            {
-                ec = http::error::body_limit;
-                goto completion;
-            }
-
-            is_continuation_ = true;
-
-            // note: this is safe. dynamic_buffers are lightweight references to storage which do not
-            // lose state when moved from
-
-            yield
-            {
-                auto pos = dyn_buf_.size();
-                dyn_buf_.grow(to_read_);
-                auto buffers = dyn_buf_.data(pos, to_read_);
-                auto &stream = stream_;
-                stream.async_read_some(buffers, std::move(*this));
-            }
-
-            dyn_buf_.shrink(to_read_ - bytes_transferred);
-
-            if (ec)
-                goto completion;
-        }
-
-        return;
-
-        completion:
-
-        this->complete(is_continuation_, ec, end_of_sequence_);
-    }
-
-#include <boost/asio/unyield.hpp>
+        max_capacity = 64
+    };
 
-private:
-    std::size_t
-    find_crlf() const
+    auto
+    operator()() const -> boost::beast::static_storage<max_capacity>
     {
-        auto buffers = dyn_buf_.data(0, dyn_buf_.size());
-        auto s = boost::beast::buffers_to_string(buffers);
-        auto pos = s.find("\r\n");
-        auto result = (pos == std::string::npos)
-                      ? std::size_t(0)
-                      : std::size_t(pos + 2);
-        return result;
-    }
-
-    Stream &stream_;
-    BeastV2DynamicBuffer dyn_buf_;
-    std::size_t to_read_ = 0;
-    std::size_t end_of_sequence_ = 0;
-    bool is_continuation_ = false;
-};
-
-struct run_read_until_crlf_op
-{
-    template<
-        class ReadHandler,
-        class AsyncReadStream,
-        class DynamicBuffer>
-    void
-    operator()(
-        ReadHandler &&h,
-        AsyncReadStream *s,
-        DynamicBuffer b)
-    {
-        using namespace boost::beast;
-
-        // If you get an error on the following line it means
-        // that your handler does not meet the documented type
-        // requirements for the handler.
-
-        static_assert(
-            detail::is_invocable<ReadHandler,
-                void(
-                    error_code,
-                    std::size_t)>::value,
-            "ReadHandler type requirements not met");
-
-        read_until_crlf_op<
-            AsyncReadStream,
-            DynamicBuffer,
-            typename std::decay<ReadHandler>::type>(*s, b,
-                                                    std::forward<ReadHandler>(h));
+        return {};
     }
-
 };
 
-template<
-    class AsyncReadStream,
-    class DynamicBuffer,
-    class ReadHandler>
-BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
-async_read_until_crlf(
-    AsyncReadStream &stream,
-    DynamicBuffer buffer,
-    ReadHandler &&handler)
-{
-    static_assert(is_async_read_stream<AsyncReadStream>::value,
-                  "AsyncReadStream type requirements not met");
-    static_assert(
-        net::is_dynamic_buffer_v2<DynamicBuffer>::value,
-        "DynamicBuffer type requirements not met");
-    return net::async_initiate<
-        ReadHandler,
-        void(
-            error_code,
-            std::size_t)>(
-        run_read_until_crlf_op(),
-        handler,
-        &stream,
-        buffer);
-}
-
-
-struct make_static
+struct make_static_ring
 {
     enum
         : std::size_t
@@ -185,7 +56,7 @@ struct make_static
     };
 
     auto
-    operator()() const -> boost::beast::static_storage<max_capacity>
+    operator()() const -> boost::beast::static_ring_storage<max_capacity>
     {
         return {};
     }
@@ -240,6 +111,56 @@ struct make_circular
 };
 #endif
 
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+struct make_mirrored_circular
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 64
+    };
+
+    auto
+    operator()() const -> boost::beast::mirrored_circular_storage
+    {
+        return boost::beast::mirrored_circular_storage(max_capacity);
+    }
+};
+#endif
+
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+struct make_mapped_file
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 64
+    };
+
+    auto
+    operator()() const -> boost::beast::mapped_file_storage
+    {
+        return boost::beast::mapped_file_storage::temporary("/tmp", max_capacity);
+    }
+};
+
+// spills once it holds more than half its limit
+struct make_spill
+{
+    enum
+        : std::size_t
+    {
+        max_capacity = 64
+    };
+
+    auto
+    operator()() const -> boost::beast::spill_storage
+    {
+        return boost::beast::spill_storage(max_capacity / 2, "/tmp", max_capacity);
+    }
+};
+#endif
+
 #if !NO_MULTI_STORAGE
 struct make_multi
 {
@@ -260,6 +181,7 @@ struct make_multi
 
 using test_list = std::tuple<
     project_test::make_static
+    , project_test::make_static_ring
     , project_test::make_beast_multi_buffer
 //    , project_test::make_beast_multi_buffer
 #if !NO_FLAT_STORAGE
@@ -271,6 +193,13 @@ using test_list = std::tuple<
 #if !NO_MULTI_STORAGE
     , project_test::make_multi
 #endif
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+    , project_test::make_mirrored_circular
+#endif
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    , project_test::make_mapped_file
+    , project_test::make_spill
+#endif
 >;
 
 TEMPLATE_LIST_TEST_CASE("read_write", "", test_list)
@@ -358,3 +287,540 @@ TEMPLATE_LIST_TEST_CASE("read_write", "", test_list)
 
 }
 
+
+
+TEMPLATE_LIST_TEST_CASE("read_until_crlf", "", test_list)
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+
+    auto client_stream = test::stream(ioc);
+    auto server_stream = test::connect(client_stream);
+
+    // deliver a few bytes at a time so that lines, and CRLFs, are split across reads
+    client_stream.read_size(3);
+    write(server_stream, net::buffer(std::string("1 the cat sat on the mat\r\n"
+                                                 "2 the cat\rsat on\nthe mat\r\n"
+                                                 "\r\n"
+                                                 "4 the cat gave up")));
+    server_stream.close();
+
+    auto storage = TestType()();
+    auto dyn_buf = dynamic_buffer(storage);
+
+    auto expected_error = error_code();
+    auto expected_data = std::string();
+    auto handler = [&](
+        error_code const &ec,
+        std::size_t bytes_transferred) {
+        CHECK(ec == expected_error);
+        CHECK(bytes_transferred == expected_data.size());
+        CHECK(buffers_to_string(dyn_buf.data(0, bytes_transferred)) == expected_data);
+
+        dyn_buf.consume(bytes_transferred);
+    };
+
+    for (auto line : {"1 the cat sat on the mat\r\n", "2 the cat\rsat on\nthe mat\r\n", "\r\n"})
+    {
+        expected_data = line;
+        project_test::async_read_until_crlf(client_stream, dyn_buf, handler);
+        ioc.run();
+        ioc.restart();
+    }
+
+    expected_data = std::string();
+    expected_error = net::error::eof;
+    project_test::async_read_until_crlf(client_stream, dyn_buf, handler);
+    ioc.run();
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == "4 the cat gave up");
+}
+
+TEMPLATE_LIST_TEST_CASE("read_until", "", test_list)
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+
+    auto client_stream = test::stream(ioc);
+    auto server_stream = test::connect(client_stream);
+
+    client_stream.read_size(3);
+    write(server_stream, net::buffer(std::string("GET / HTTP/1.1\r\nHost: a\r\n\r\n"
+                                                 "\r\n\r\n"
+                                                 "GET /b HTTP/1.1\r\n\r")));
+    server_stream.close();
+
+    auto storage = TestType()();
+    auto dyn_buf = dynamic_buffer(storage);
+
+    auto expected_error = error_code();
+    auto expected_data = std::string();
+    auto handler = [&](
+        error_code const &ec,
+        std::size_t bytes_transferred) {
+        CHECK(ec == expected_error);
+        CHECK(bytes_transferred == expected_data.size());
+        CHECK(buffers_to_string(dyn_buf.data(0, bytes_transferred)) == expected_data);
+
+        dyn_buf.consume(bytes_transferred);
+    };
+
+    for (auto header : {"GET / HTTP/1.1\r\nHost: a\r\n\r\n", "\r\n\r\n"})
+    {
+        expected_data = header;
+        project_test::async_read_until(client_stream, dyn_buf, "\r\n\r\n", handler);
+        ioc.run();
+        ioc.restart();
+    }
+
+    expected_data = std::string();
+    expected_error = net::error::eof;
+    project_test::async_read_until(client_stream, dyn_buf, "\r\n\r\n", handler);
+    ioc.run();
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == "GET /b HTTP/1.1\r\n\r");
+}
+
+TEMPLATE_LIST_TEST_CASE("read_lines", "", test_list)
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+
+    auto client_stream = test::stream(ioc);
+    auto server_stream = test::connect(client_stream);
+
+    auto expected = std::vector<std::string>();
+    auto text = std::string();
+    for (int i = 1; i <= 8; ++i)
+    {
+        expected.push_back(std::to_string(i) + " cat");
+        text += expected.back() + "\r\n";
+    }
+    write(server_stream, net::buffer(text + "9 gave up"));
+    server_stream.close();
+
+    auto storage = TestType()();
+    auto dyn_buf = dynamic_buffer(storage);
+    auto lines = line_batch();
+    auto received = std::vector<std::string>();
+    auto batches = std::size_t(0);
+    auto last_ec = error_code();
+
+    auto handler = [&](
+        error_code const &ec,
+        std::size_t bytes_transferred) {
+        last_ec = ec;
+        CHECK(bytes_transferred == lines.bytes());
+        if (ec)
+            return;
+        ++batches;
+        for (auto line : lines)
+            received.push_back(buffers_to_string(dyn_buf.data(line.offset, line.size)));
+        dyn_buf.consume(bytes_transferred);
+    };
+
+    while (!last_ec)
+    {
+        project_test::async_read_lines(client_stream, dyn_buf, "\r\n", lines, handler);
+        ioc.run();
+        ioc.restart();
+    }
+
+    // the first read brings in every line
+    CHECK(last_ec == net::error::eof);
+    CHECK(batches == 1);
+    CHECK(received == expected);
+    CHECK(lines.empty());
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == "9 gave up");
+}
+
+TEST_CASE("read_lines over split reads", "")
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+
+    auto client_stream = test::stream(ioc);
+    auto server_stream = test::connect(client_stream);
+    client_stream.read_size(5);
+    write(server_stream, net::buffer(std::string("a\r\n\r\nbc\r\nd\r")));
+    server_stream.close();
+
+    auto storage = flat_storage();
+    auto dyn_buf = dynamic_buffer(storage);
+    auto lines = line_batch();
+    auto received = std::vector<std::string>();
+    auto last_ec = error_code();
+
+    auto handler = [&](
+        error_code const &ec,
+        std::size_t bytes_transferred) {
+        last_ec = ec;
+        for (auto line : lines)
+            received.push_back(std::string(line_string(dyn_buf, line)));
+        dyn_buf.consume(bytes_transferred);
+    };
+
+    while (!last_ec)
+    {
+        project_test::async_read_lines(client_stream, dyn_buf, "\r\n", lines, handler);
+        ioc.run();
+        ioc.restart();
+    }
+
+    CHECK(last_ec == net::error::eof);
+    CHECK(received == std::vector<std::string>{"a", "", "bc"});
+    CHECK(buffers_to_string(dyn_buf.data(0, dyn_buf.size())) == "d\r");
+}
+
+TEST_CASE("adaptive_read_size", "")
+{
+    using namespace boost::beast;
+
+    auto sizing = adaptive_read_size(4096, 1024, 16384);
+    CHECK(sizing.next(100000) == 4096);
+    CHECK(sizing.next(100) == 100);
+
+    sizing.update(4096, 4096);
+    CHECK(sizing.current() == 8192);
+    sizing.update(8192, 8192);
+    sizing.update(16384, 16384);
+    CHECK(sizing.current() == 16384);
+
+    // a region clamped by the buffer limit which is filled does not grow the read size
+    sizing = adaptive_read_size(4096);
+    sizing.update(100, 100);
+    CHECK(sizing.current() == 4096);
+
+    sizing.update(4096, 3000);
+    CHECK(sizing.current() == 4096);
+    sizing.update(4096, 10);
+    CHECK(sizing.current() == 2048);
+    sizing.update(2048, 10);
+    sizing.update(1024, 10);
+    sizing.update(512, 10);
+    CHECK(sizing.current() == adaptive_read_size::default_lower);
+
+    auto fixed = adaptive_read_size::fixed(300);
+    fixed.update(300, 300);
+    fixed.update(300, 1);
+    CHECK(fixed.current() == 300);
+}
+
+TEST_CASE("read_until adapts the read size", "")
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+
+    auto client_stream = test::stream(ioc);
+    auto server_stream = test::connect(client_stream);
+
+    auto line = std::string(100000, 'x') + "\r\n";
+    write(server_stream, net::buffer(line + "short\r\n"));
+
+    auto storage = flat_storage();
+    auto dyn_buf = dynamic_buffer(storage);
+    auto sizing = adaptive_read_size(1024, 512, 32768);
+
+    auto reads = std::size_t(0);
+    auto handler = [&](
+        error_code const &ec,
+        std::size_t bytes_transferred) {
+        CHECK(!ec);
+        reads = bytes_transferred;
+    };
+
+    project_test::async_read_until_crlf(client_stream, dyn_buf, sizing, handler);
+    ioc.run();
+    ioc.restart();
+    // reads of 1, 2, 4, 8, 16 and 32 KiB fill, then 32 KiB and a short final read which halves the size
+    CHECK(reads == line.size());
+    CHECK(sizing.current() == 16384);
+    dyn_buf.consume(reads);
+
+    // the line is already buffered; the next read completes without adapting
+    project_test::async_read_until_crlf(client_stream, dyn_buf, sizing, handler);
+    ioc.run();
+    CHECK(reads == 7);
+    CHECK(sizing.current() == 16384);
+}
+
+namespace {
+
+// Reads lines with the state of each read in a handler_memory
+struct line_counter
+{
+    using allocator_type = boost::beast::handler_memory_allocator<char>;
+
+    boost::asio::local::stream_protocol::socket *socket;
+    boost::beast::flat_storage_dynamic_buffer dyn_buf;
+    boost::beast::handler_memory *memory;
+    std::size_t *lines;
+
+    allocator_type
+    get_allocator() const noexcept
+    {
+        return allocator_type(*memory);
+    }
+
+    void
+    operator()(
+        boost::beast::error_code ec,
+        std::size_t bytes_transferred)
+    {
+        if (ec)
+            return;
+        ++*lines;
+        dyn_buf.consume(bytes_transferred);
+        boost::beast::async_read_until_crlf(*socket, dyn_buf, std::move(*this));
+    }
+};
+
+}
+
+TEST_CASE("read_until allocates operations through the handler's allocator", "")
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+    auto reader = net::local::stream_protocol::socket(ioc);
+    auto writer = net::local::stream_protocol::socket(ioc);
+    net::local::connect_pair(reader, writer);
+
+    auto storage = flat_storage();
+    auto memory = handler_memory();
+    auto lines = std::size_t(0);
+
+    auto text = std::string();
+    for (int i = 0; i < 100; ++i)
+        text += "line " + std::to_string(i) + "\r\n";
+    net::write(writer, net::buffer(text));
+    writer.shutdown(net::socket_base::shutdown_send);
+
+    boost::beast::async_read_until_crlf(reader, dynamic_buffer(storage),
+                                        line_counter{&reader, dynamic_buffer(storage), &memory, &lines});
+    ioc.run();
+
+    CHECK(lines == 100);
+    CHECK(memory.allocations() > 0);
+    CHECK(memory.fallbacks() == 0);
+}
+
+#if BOOST_BEAST_HAS_CO_AWAIT
+
+namespace {
+
+// The least a coroutine needs: it starts at once and destroys itself when done
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached_task
+read_lines(
+    boost::asio::local::stream_protocol::socket &socket,
+    boost::beast::flat_storage &storage,
+    boost::beast::handler_memory &memory,
+    std::vector<std::string> &lines,
+    boost::beast::error_code &ec)
+{
+    using namespace boost::beast;
+
+    auto dyn_buf = dynamic_buffer(storage);
+    try
+    {
+        for (;;)
+        {
+            auto n = co_await boost::beast::co_read_until_crlf(socket, dyn_buf, memory);
+            lines.push_back(buffers_to_string(dyn_buf.data(0, n - 2)));
+            dyn_buf.consume(n);
+        }
+    }
+    catch (system_error const &e)
+    {
+        ec = e.code();
+    }
+}
+
+}
+
+TEST_CASE("co_read_until_crlf", "")
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+    auto reader = net::local::stream_protocol::socket(ioc);
+    auto writer = net::local::stream_protocol::socket(ioc);
+    net::local::connect_pair(reader, writer);
+
+    net::write(writer, net::buffer(std::string("one\r\ntwo\r\nthree\r\n")));
+    writer.shutdown(net::socket_base::shutdown_send);
+
+    auto storage = flat_storage();
+    auto memory = handler_memory();
+    auto lines = std::vector<std::string>();
+    auto ec = error_code();
+
+    read_lines(reader, storage, memory, lines, ec);
+    ioc.run();
+
+    CHECK(lines == std::vector<std::string>{"one", "two", "three"});
+    CHECK(ec == net::error::eof);
+    CHECK(memory.allocations() > 0);
+    CHECK(memory.fallbacks() == 0);
+}
+
+#endif
+
+namespace {
+
+// Counts the writes made to a test stream
+struct counting_write_stream
+{
+    using executor_type = boost::beast::test::stream::executor_type;
+
+    boost::beast::test::stream &next;
+    std::size_t writes = 0;
+
+    executor_type
+    get_executor()
+    {
+        return next.get_executor();
+    }
+
+    template<class ConstBufferSequence, class WriteHandler>
+    void
+    async_write_some(ConstBufferSequence const &buffers, WriteHandler &&handler)
+    {
+        ++writes;
+        next.async_write_some(buffers, std::forward<WriteHandler>(handler));
+    }
+};
+
+}
+
+// the multi_buffer proxy supports only the grow and shrink pairs of read operations
+using write_test_list = std::tuple<
+    project_test::make_static
+    , project_test::make_static_ring
+#if !NO_FLAT_STORAGE
+    , project_test::make_flat
+#endif
+#if !NO_CIRCULAR_STORAGE
+    , project_test::make_circular
+#endif
+#if !NO_MULTI_STORAGE
+    , project_test::make_multi
+#endif
+#if BOOST_BEAST_HAS_MIRRORED_CIRCULAR_STORAGE
+    , project_test::make_mirrored_circular
+#endif
+#if BOOST_BEAST_HAS_MAPPED_FILE_STORAGE
+    , project_test::make_mapped_file
+    , project_test::make_spill
+#endif
+>;
+
+TEMPLATE_LIST_TEST_CASE("coalescing_writer", "", write_test_list)
+{
+    using namespace boost::beast;
+
+    net::io_context ioc(1);
+
+    auto client_stream = test::stream(ioc);
+    auto server_stream = test::connect(client_stream);
+    auto stream = counting_write_stream{client_stream};
+
+    auto storage = TestType()();
+    auto expected = std::string();
+    auto flushed = std::size_t(0);
+    auto on_flush = [&](error_code const &ec) {
+        CHECK(!ec);
+        ++flushed;
+    };
+
+    SECTION("messages behind a write share the next one")
+    {
+        auto writer = coalescing_writer<counting_write_stream, decltype(dynamic_buffer(storage))>(
+            stream, dynamic_buffer(storage));
+        for (int i = 0; i < 10; ++i)
+        {
+            auto message = "m" + std::to_string(i) + ";";
+            writer.write(net::buffer(message));
+            expected += message;
+        }
+        CHECK(stream.writes == 1);
+        writer.async_flush(on_flush);
+        ioc.run();
+        CHECK(flushed == 1);
+        CHECK(stream.writes == 2);
+        CHECK(writer.pending() == 0);
+    }
+
+    SECTION("cork holds messages until uncork")
+    {
+        auto writer = coalescing_writer<counting_write_stream, decltype(dynamic_buffer(storage))>(
+            stream, dynamic_buffer(storage));
+        writer.cork();
+        for (int i = 0; i < 10; ++i)
+        {
+            auto message = "c" + std::to_string(i) + ";";
+            writer.write(net::buffer(message));
+            expected += message;
+        }
+        ioc.poll();
+        ioc.restart();
+        CHECK(stream.writes == 0);
+        writer.uncork();
+        writer.async_flush(on_flush);
+        ioc.run();
+        CHECK(flushed == 1);
+        CHECK(stream.writes == 1);
+    }
+
+    SECTION("a flush size or delay releases held messages")
+    {
+        auto writer = coalescing_writer<counting_write_stream, decltype(dynamic_buffer(storage))>(
+            stream, dynamic_buffer(storage), 12, std::chrono::milliseconds(1));
+        writer.write(net::buffer(std::string("abcd")));
+        writer.write(net::buffer(std::string("efgh")));
+        CHECK(stream.writes == 0);
+        writer.write(net::buffer(std::string("ijkl")));
+        CHECK(stream.writes == 1);
+        ioc.run();
+        ioc.restart();
+
+        writer.write(net::buffer(std::string("mn")));
+        CHECK(stream.writes == 1);
+        ioc.run();
+        CHECK(stream.writes == 2);
+        CHECK(writer.pending() == 0);
+        expected = "abcdefghijklmn";
+    }
+
+    SECTION("a failed write is kept and reported")
+    {
+        auto writer = coalescing_writer<counting_write_stream, decltype(dynamic_buffer(storage))>(
+            stream, dynamic_buffer(storage));
+        client_stream.close();
+        writer.write(net::buffer(std::string("lost")));
+        auto flush_ec = error_code();
+        writer.async_flush([&](error_code const &ec) { flush_ec = ec; });
+        ioc.run();
+        CHECK(flush_ec);
+        CHECK(writer.error() == flush_ec);
+        writer.write(net::buffer(std::string("discarded")));
+        CHECK(stream.writes == 1);
+    }
+
+    CHECK(server_stream.str() == expected);
+}